@@ -0,0 +1,5 @@
+#!/bin/sh
+# Stands in for ./process as a child that only speaks version 1 of the
+# protocol, by dropping the --protocol flag it is given
+for name; do :; done
+exec ../../process "$name"
@@ -0,0 +1,73 @@
+#ifndef __ACCOUNTING_H__
+#define __ACCOUNTING_H__
+
+#include "defines.h"
+
+/**
+ * Per process accounting. When an accounting file is open, one CSV record
+ * is written for every process as it finishes, so turnaround can be split 
+ * into time spent waiting for memory, waiting in the ready queue and running.
+*/
+
+/**
+ * @param name name of the process' program
+ * @param time_arrived time the program arrived
+ * @param admitted_time time the process was admitted to the ready list
+ * @param first_run_time time the process first started running
+ * @param suspend_count number of times the process was preempted
+ * @param block_count number of times the process blocked on I/O
+ * @param ready_wait total time spent in the ready list
+ * @param finish_time time the process finished
+ * @param memory_index index of the process' memory block, or -1 if the 
+ * process was not allocated a block
+ * @param memory_size memory required by the process
+ * @param service_time simulated service time of the process
+ * @param user_seconds real CPU time the child process spent in user mode
+ * @param system_seconds real CPU time the child process spent in the kernel
+ * @param voluntary_switches context switches where the child process blocked
+ * @param involuntary_switches context switches where the child process was 
+ * preempted
+ * @param max_rss_kb largest resident set size of the child process
+*/
+typedef struct accounting_record {
+    const char* name;
+    uint32_t time_arrived;
+    uint32_t admitted_time;
+    uint32_t first_run_time;
+    uint32_t suspend_count;
+    uint32_t block_count;
+    uint32_t ready_wait;
+    uint32_t finish_time;
+    int64_t memory_index;
+    uint32_t memory_size;
+    uint32_t service_time;
+    double user_seconds;
+    double system_seconds;
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
+    uint64_t max_rss_kb;
+} accounting_record;
+
+/**
+ * @brief
+ * Opens an accounting file and writes its CSV header. Exits the program 
+ * if the file cannot be opened.
+ * @param path path to accounting file
+*/
+void accounting_open(const char* path);
+
+/**
+ * @brief
+ * Writes a record to the accounting file. Does nothing if no accounting
+ * file is open.
+ * @param pRecord pointer to record
+*/
+void accounting_write(accounting_record* pRecord);
+
+/**
+ * @brief
+ * Flushes and closes the accounting file, if one is open.
+*/
+void accounting_close();
+
+#endif
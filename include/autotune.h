@@ -0,0 +1,56 @@
+#ifndef __AUTOTUNE_H__
+#define __AUTOTUNE_H__
+
+#include "defines.h"
+#include "process_manager.h"
+
+/**
+ * Automatic search for the scheduler, memory strategy and quantum that suit a
+ * trace best. Every combination of scheduler, strategy and a fixed list of
+ * quanta is a candidate. Candidates are raced with successive halving: each
+ * round simulates the surviving candidates on a prefix of the trace, keeps the
+ * better half, and doubles the prefix, until the last round simulates the
+ * whole trace. Prefixes keep dependencies valid, since a program only depends
+ * on programs added before it.
+*/
+
+typedef enum autotune_objective {
+    OBJECTIVE_TURNAROUND,
+    OBJECTIVE_P99_OVERHEAD,
+    OBJECTIVE_MAKESPAN,
+} AUTOTUNE_OBJECTIVE;
+
+#define AUTOTUNE_OBJECTIVE_NAMES { "turnaround", "p99-overhead", "makespan" }
+
+/**
+ * @param objective metric that is minimised
+ * @param costs state transition costs
+ * @param thread_count number of threads, or 0 for one per online CPU
+*/
+typedef struct autotune_config {
+    AUTOTUNE_OBJECTIVE objective;
+    cost_model costs;
+    uint32_t thread_count;
+} autotune_config;
+
+/**
+ * @brief
+ * Parses the name of an objective.
+ * @param name name of the objective
+ * @param pObjective pointer to where the objective is stored
+ * @return
+ * Whether the name is an objective
+*/
+bool autotune_parse_objective(const char* name, AUTOTUNE_OBJECTIVE* pObjective);
+
+/**
+ * @brief
+ * Searches for the best configuration of a trace, and prints every round,
+ * the best configuration and the cost of the search. Exits the program if
+ * the file cannot be opened.
+ * @param filename input file
+ * @param pConfig pointer to configuration
+*/
+void autotune_run(const char* filename, const autotune_config* pConfig);
+
+#endif
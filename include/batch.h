@@ -0,0 +1,33 @@
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include "defines.h"
+
+/**
+ * Batch runner for many traces. Each line of a manifest names an input file,
+ * the flags of a run and the file its output is expected to match:
+ *
+ *     input [-s scheduler] [-m strategy] -q quantum [-c costs] [-P] [-B]
+ *         [--protocol=n] [--speculate] expected
+ *
+ * The strategy is infinite or best-fit, and the quantum must be positive.
+ * Blank lines and lines starting with # are skipped. Every run happens in
+ * this process on a work-stealing thread pool, each thread with its own
+ * thread local process manager. Output is captured in memory and compared
+ * with the expected file, and the first differing line of every failed run
+ * is reported.
+*/
+
+/**
+ * @brief
+ * Runs every line of a manifest and reports the runs that failed. Exits the
+ * program if the manifest cannot be read or a line cannot be parsed.
+ * @param manifest_path path to manifest
+ * @param thread_count number of threads, or 0 for one per online CPU
+ * @param protocol protocol used by runs that do not give --protocol
+ * @return
+ * Number of runs whose output did not match
+*/
+uint32_t batch_run(const char* manifest_path, uint32_t thread_count, uint32_t protocol);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include "defines.h"
+#include "report.h"
+
+/**
+ * Content-addressed cache of complete runs. A run is keyed by the SHA-256 of
+ * its input bytes, of the bytes of its scheduler plugin if it has one, and of
+ * a description of every flag that changes its output. An entry holds the
+ * output of the run and its report, if one was asked for. A hit replays the
+ * entry instead of simulating, and says so on stderr. The report stored in an
+ * entry leaves out timings, which a replay would repeat from another run, but
+ * the report of the run that missed keeps them.
+ *
+ * Every entry is one file in the cache directory named by its key. Entries
+ * are written to a temporary file and renamed into place, so a reader never
+ * sees half an entry, even with several runs sharing the directory. A hit
+ * updates the modification time of its entry, and after every write the
+ * entries used least recently are removed until the directory fits its size.
+ * A rebuilt plugin has new bytes, so its runs miss.
+*/
+
+#define CACHE_DEFAULT_DIRECTORY ".allocate-cache"
+#define CACHE_DEFAULT_MEGABYTES 64
+
+/**
+ * @brief
+ * Opens a cache directory, creating it if it does not exist. Exits the
+ * program if it cannot be created.
+ * @param directory path of cache directory
+ * @param max_bytes largest total size of the entries
+*/
+void cache_open(const char* directory, uint64_t max_bytes);
+
+/**
+ * @brief
+ * Computes the key of a run.
+ * @param filename input file
+ * @param plugin_path shared object of the scheduler, or NULL for a built in one
+ * @param configuration description of the flags of the run
+ * @param key where the key is stored as a null-terminated hex string
+ * @return
+ * Whether the input file and plugin could be read. A run that cannot be 
+ * keyed is not cached.
+*/
+bool cache_key(const char* filename, const char* plugin_path, const char* configuration, 
+    char key[SHA_HASH_SIZE + 1]);
+
+/**
+ * @brief
+ * Replays the entry of a key if there is one. Its output is written to a
+ * stream and its report, if report_path is not NULL, is written to a file.
+ * @param key key of the run
+ * @param pOutput stream the output is written to
+ * @param report_path path the report is written to, or NULL
+ * @return
+ * Whether there was an entry. An unreadable or damaged entry is a miss.
+*/
+bool cache_replay(const char* key, FILE* pOutput, const char* report_path);
+
+/**
+ * @brief
+ * Starts capturing the output of a run that missed.
+ * @param pOutput stream the output is passed through to
+ * @return
+ * Stream the run writes its output to instead of pOutput
+*/
+FILE* cache_capture(FILE* pOutput);
+
+/**
+ * @brief
+ * Closes the stream returned by cache_capture() and stores the captured
+ * output, with the report without its timings if pReport is not NULL, as the 
+ * entry of a key. Then evicts entries until the cache fits its size. A failed
+ * write leaves the cache without the entry, and is reported on stderr.
+ * @param key key of the run
+ * @param pReport pointer to the report of the run, or NULL
+*/
+void cache_store(const char* key, report* pReport);
+
+#endif
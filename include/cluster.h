@@ -0,0 +1,82 @@
+#ifndef __CLUSTER_H__
+#define __CLUSTER_H__
+
+#include "defines.h"
+#include "process_manager.h"
+
+/**
+ * Simulation of a cluster of nodes on one host. A coordinator reads a trace
+ * and starts one worker allocate per node, each with its own process manager,
+ * and so its own CPU and memory. Workers connect back over a Unix domain
+ * socket. The coordinator sends each program to a node chosen by a balancing
+ * policy when it arrives, and steps the nodes through simulated time in lock
+ * step, one quantum at a time. A node that has finished its programs is not
+ * stepped until it is sent another, so its makespan is its own.
+ *
+ * Nodes cannot see each other's programs, so programs connected by their
+ * dependencies all run on one node. The first program of each connected
+ * component goes to the node chosen by the policy, and every later program
+ * of the component follows it. Workers connect to a socket in a private
+ * directory made with mkdtemp(), which is removed once every worker has
+ * connected.
+*/
+
+typedef enum balance_policy {
+    BALANCE_ROUND_ROBIN,    // Nodes in turn
+    BALANCE_LEAST_LOADED,   // Node with the fewest unfinished programs
+    BALANCE_MEMORY_AWARE,   // Least loaded node the program fits in right now
+} BALANCE_POLICY;
+
+#define BALANCE_POLICY_NAMES { "rr", "least-loaded", "memory-aware" }
+
+/**
+ * @param node_count number of nodes
+ * @param policy balancing policy of the coordinator
+ * @param scheduler_name name or path of the scheduler of every node
+ * @param strategy memory strategy of every node
+ * @param quantum length of a quantum
+ * @param costs state transition costs
+ * @param protocol protocol nodes control their children with
+*/
+typedef struct cluster_config {
+    uint32_t node_count;
+    BALANCE_POLICY policy;
+    const char* scheduler_name;
+    MEMORY_STRATEGY strategy;
+    uint32_t quantum;
+    cost_model costs;
+    uint32_t protocol;
+} cluster_config;
+
+/**
+ * @brief
+ * Parses the name of a balancing policy.
+ * @param name name of the policy
+ * @param pPolicy pointer to where the policy is stored
+ * @return
+ * Whether the name is a policy
+*/
+bool cluster_parse_policy(const char* name, BALANCE_POLICY* pPolicy);
+
+/**
+ * @brief
+ * Runs the coordinator. Prints the statistics of every node and of the whole
+ * cluster, and the coordinator overhead per dispatch to stderr. Exits the
+ * program if the file cannot be opened or a worker fails.
+ * @param filename input file
+ * @param pConfig pointer to configuration
+*/
+void cluster_coordinate(const char* filename, const cluster_config* pConfig);
+
+/**
+ * @brief
+ * Runs a worker, which simulates one node for the coordinator listening on
+ * a socket until it is told to finish. Exits the program if the connection
+ * fails.
+ * @param socket_path path of the coordinator's socket
+ * @param pConfig pointer to configuration, of which node_count and policy
+ * are unused
+*/
+void cluster_work(const char* socket_path, const cluster_config* pConfig);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef __COUNTERS_H__
+#define __COUNTERS_H__
+
+#include "defines.h"
+
+/**
+ * Counts the work done by data structures inside each scheduling decision.
+ * Counts are accumulated over one tick of the execution loop, then folded 
+ * into a per counter histogram by counters_tick(), so the report shows how
+ * much work a typical tick and the worst tick did.
+*/
+
+typedef enum counter {
+    COUNTER_SJF_VISITED,        // Ready list nodes visited by shortest_job_first()
+    COUNTER_BEST_FIT_INSPECTED, // Free blocks inspected by allocator_find_best_fit()
+    COUNTER_PENDING_RETRIED,    // Input programs retried by check_pending()
+    COUNTER_TERMINATE_WALKED,   // Active list nodes walked by should_terminate()
+    COUNTER_FREE_WALKED,        // Free list nodes walked by allocater_free_memory()
+    COUNTER_COUNT
+} COUNTER;
+
+extern THREAD_LOCAL uint64_t counter_ticks[COUNTER_COUNT];
+
+// Adding to a counter is a single memory add, so counters are always on and
+// only the per tick folding is skipped when counters are disabled
+#define COUNTER_ADD(counter, n) (counter_ticks[counter] += (n))
+
+/**
+ * @brief
+ * Enables folding of counts into histograms at the end of every tick.
+*/
+void counters_enable();
+
+/**
+ * @brief
+ * Folds the counts accumulated during the current tick into each counter's 
+ * histogram if counters are enabled, then resets the counts.
+*/
+void counters_tick();
+
+/**
+ * @brief
+ * Prints a histogram of per tick counts for every counter, if counters 
+ * are enabled.
+ * @param fp file to print to
+*/
+void counters_print(FILE* fp);
+
+#endif
@@ -27,6 +27,10 @@
 #define PIPE_WRITE 1
 #define SHA_HASH_SIZE 64
 #define PID_NULL_HANDLE -2
+#define PID_EMULATED_HANDLE -3
+
+// Simulation state is kept per thread, so batch runs can share one process
+#define THREAD_LOCAL _Thread_local
 
 #ifdef DEBUG
 #define debug_log(string,...) printf(string, ##__VA_ARGS__);
@@ -0,0 +1,59 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include "defines.h"
+
+/**
+ * Fixed memory HDR (high dynamic range) histogram of unsigned integers. 
+ * Values below HISTOGRAM_SUB_BUCKETS are counted exactly, and larger values 
+ * are counted in buckets whose width is at most 1/64th of the values they 
+ * hold. Recording a value takes O(1) time and the histogram never grows no 
+ * matter how many values are recorded, or how large they are.
+*/
+
+#define HISTOGRAM_PRECISION 7
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_PRECISION)
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS + \
+    (64 - HISTOGRAM_PRECISION)*(HISTOGRAM_SUB_BUCKETS/2))
+
+/**
+ * @param counts number of values recorded in each bucket
+ * @param total number of values recorded
+ * @param sum sum of all values recorded
+ * @param max largest value recorded
+*/
+typedef struct histogram {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max;
+} histogram;
+
+/**
+ * @brief
+ * Records a value into a histogram.
+ * @param pHistogram pointer to histogram
+ * @param value value to be recorded
+*/
+void histogram_record(histogram* pHistogram, uint64_t value);
+
+/**
+ * @param pHistogram pointer to histogram
+ * @param percentile percentile between 0 and 100
+ * @return
+ * Largest value that falls in the same bucket as the value at the given 
+ * percentile, capped at the largest recorded value. 0 if the histogram is empty.
+*/
+uint64_t histogram_percentile(histogram* pHistogram, double percentile);
+
+/**
+ * @brief
+ * Prints the number of values recorded in each power of two range, along 
+ * with the mean and max of a histogram.
+ * @param fp file to print to
+ * @param name name printed before the histogram
+ * @param pHistogram pointer to histogram
+*/
+void histogram_print(FILE* fp, const char* name, histogram* pHistogram);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef __LOGGER_H__
+#define __LOGGER_H__
+
+#include "defines.h"
+
+/**
+ * Runtime leveled logger that records into an in-memory ring buffer instead 
+ * of printing. A record is the format string's address and up to 
+ * LOG_MAX_ARGS arguments stored as 64 bit integers, so recording is a few 
+ * stores and formatting is deferred until the ring is dumped to stderr on 
+ * SIGUSR1, on a crash signal or by logger_dump(). Only the last LOG_RING_SIZE 
+ * records are kept.
+ * 
+ * Format strings must be literals. Arguments must be integers, pointers or
+ * strings, and strings are copied into the record, so together they are
+ * truncated to LOG_STRING_SIZE - 1 characters. Conversions are limited to
+ * d, i, u, o, x, X, c, s and p, with the - and 0 flags and a width, since
+ * dumps are formatted without printf. DEBUG builds also print every record
+ * as it is made, like debug_log.
+*/
+
+#define LOG_RING_SIZE 4096 // Must be a power of two
+#define LOG_MAX_ARGS 4
+#define LOG_STRING_SIZE 64
+
+typedef enum log_level {
+    LOG_OFF,
+    LOG_ERROR,
+    LOG_WARN,
+    LOG_INFO,
+    LOG_DEBUG,
+    LOG_LEVEL_COUNT
+} LOG_LEVEL;
+
+extern LOG_LEVEL log_level;
+
+#define LOG_ARG(x) ((uint64_t)(uintptr_t)(x))
+#define LOG_ARGS_0() 
+#define LOG_ARGS_1(a) LOG_ARG(a)
+#define LOG_ARGS_2(a, b) LOG_ARG(a), LOG_ARG(b)
+#define LOG_ARGS_3(a, b, c) LOG_ARG(a), LOG_ARG(b), LOG_ARG(c)
+#define LOG_ARGS_4(a, b, c, d) LOG_ARG(a), LOG_ARG(b), LOG_ARG(c), LOG_ARG(d)
+#define LOG_SELECT(_0, _1, _2, _3, _4, NAME, ...) NAME
+
+// Checking the level is a single load, and arguments are only evaluated if
+// the record will be kept. The leading 0 keeps the array non-empty.
+#define LOG(level, format, ...) do { \
+    if ((level) <= log_level) { \
+        uint64_t log_args[] = { 0, LOG_SELECT(_0, ##__VA_ARGS__, LOG_ARGS_4, \
+            LOG_ARGS_3, LOG_ARGS_2, LOG_ARGS_1, LOG_ARGS_0)(__VA_ARGS__) }; \
+        logger_record(level, format, log_args + 1, \
+            sizeof(log_args)/sizeof(uint64_t) - 1); \
+    } \
+} while(0)
+
+/**
+ * @brief
+ * Sets the log level and installs the handlers that dump the ring buffer on
+ * SIGUSR1 and on crash signals.
+ * @param level most verbose level that is recorded
+*/
+void logger_initialise(LOG_LEVEL level);
+
+/**
+ * @brief
+ * Parses a log level name.
+ * @param name one of off, error, warn, info or debug
+ * @param pLevel pointer to where the level will be stored
+ * @return
+ * Whether or not name is a log level
+*/
+bool logger_parse_level(const char* name, LOG_LEVEL* pLevel);
+
+/**
+ * @brief
+ * Appends a record to the ring buffer, overwriting the oldest record if it is
+ * full. Use LOG() instead of calling this directly. Lock free and safe to call
+ * from several threads. A record whose slot is still being written by a
+ * thread a whole ring behind is dropped.
+ * @param level level of the record
+ * @param format printf style format with integer, pointer and string conversions
+ * @param pArgs arguments of the format
+ * @param arg_count number of arguments, at most LOG_MAX_ARGS
+*/
+void logger_record(LOG_LEVEL level, const char* format, uint64_t* pArgs, uint32_t arg_count);
+
+/**
+ * @brief
+ * Formats the records in the ring buffer, oldest first, and writes them to 
+ * stderr. Formats by hand and writes with write(), so it is async-signal-safe
+ * and called from signal handlers.
+*/
+void logger_dump();
+
+#endif
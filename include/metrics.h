@@ -0,0 +1,69 @@
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include "defines.h"
+#include "process_manager.h"
+
+/**
+ * Prometheus text format metrics, served over HTTP from a separate thread on 
+ * a Unix socket or loopback port given with --metrics. The execution loop 
+ * publishes a snapshot under a sequence lock at most every 
+ * METRICS_PUBLISH_INTERVAL seconds, and the server thread only ever copies 
+ * the latest snapshot, so a scrape never blocks the execution loop.
+*/
+
+#define METRICS_PUBLISH_INTERVAL 0.1
+#define METRICS_BUCKET_COUNT 16 // Upper bounds of 1us, 2us, 4us ... 32.768ms
+
+typedef enum metrics_phase {
+    PHASE_ADMIT,    // check_pending()
+    PHASE_SCHEDULE, // keep_process_running() and switch_process()
+    PHASE_UPDATE,   // update()
+    PHASE_COUNT
+} METRICS_PHASE;
+
+/**
+ * @brief
+ * Starts the metrics server thread. Addresses made only of digits are 
+ * loopback TCP ports, anything else is the path of a Unix socket. A socket
+ * already at the path is replaced, and anything else there is an error.
+ * @param address port or socket path
+*/
+void metrics_start(const char* address);
+
+/**
+ * @brief
+ * Reads the clock used to time phases.
+ * @return
+ * Monotonic time in nanoseconds, or 0 if metrics are not being served
+*/
+uint64_t metrics_now();
+
+/**
+ * @brief
+ * Records the latency of a phase of the execution loop that began at start.
+ * Does nothing if metrics are not being served.
+ * @param phase phase that just ended
+ * @param start time the phase began, from metrics_now()
+ * @return
+ * Time the phase ended, which is when the next phase begins
+*/
+uint64_t metrics_phase(METRICS_PHASE phase, uint64_t start);
+
+/**
+ * @brief
+ * Publishes a new snapshot for the server thread if the last one is older 
+ * than METRICS_PUBLISH_INTERVAL. Does nothing if metrics are not being served.
+ * @param manager process manager handle
+ * @param force publish even if the last snapshot is recent
+*/
+void metrics_publish(process_manager manager, bool force);
+
+/**
+ * @brief
+ * Stops the server thread and removes the Unix socket, if there is one.
+ * A client that is still connected is disconnected.
+*/
+void metrics_stop();
+
+#endif
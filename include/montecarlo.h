@@ -0,0 +1,56 @@
+#ifndef __MONTECARLO_H__
+#define __MONTECARLO_H__
+
+#include "defines.h"
+#include "process_manager.h"
+
+/**
+ * Monte-Carlo evaluation of a workload. An input file is the template of a
+ * distribution, and each variant drawn from it perturbs the template:
+ *
+ *     - the gap between consecutive arrivals is shifted uniformly by up to
+ *       arrival_jitter in either direction, never below 0, so arrival order
+ *       and therefore dependencies are preserved
+ *     - every CPU burst is scaled by one normally distributed factor per
+ *       program, with a relative standard deviation of service_noise
+ *     - memory is scaled by a normally distributed factor with a relative
+ *       standard deviation of memory_noise, and kept between 1 and 2048 MB
+ *
+ * Every variant is simulated under every scheduler and memory strategy on a
+ * work-stealing thread pool. Variant i always draws from the same random
+ * stream, so the report only depends on the seed and not on the threads.
+*/
+
+/**
+ * @param variant_count number of variants, at least 2
+ * @param arrival_jitter largest shift of an inter-arrival gap
+ * @param service_noise relative standard deviation of CPU bursts
+ * @param memory_noise relative standard deviation of memory
+ * @param seed seed of the random streams
+ * @param quantum length of a quantum
+ * @param costs state transition costs
+ * @param thread_count number of threads, or 0 for one per online CPU
+*/
+typedef struct montecarlo_config {
+    uint32_t variant_count;
+    uint32_t arrival_jitter;
+    double service_noise;
+    double memory_noise;
+    uint64_t seed;
+    uint32_t quantum;
+    cost_model costs;
+    uint32_t thread_count;
+} montecarlo_config;
+
+/**
+ * @brief
+ * Simulates variants of an input file and prints the mean of turnaround
+ * time, average overhead and makespan with a 95% confidence interval for
+ * every scheduler and memory strategy. Exits the program if the file cannot
+ * be opened.
+ * @param filename template input file
+ * @param pConfig pointer to configuration
+*/
+void montecarlo_run(const char* filename, const montecarlo_config* pConfig);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#include "defines.h"
+#include "process_manager.h"
+#include "report.h"
+
+/**
+ * Pipelined execution with --pipeline. A parser thread reads the input file
+ * and passes programs through a lock-free SPSC queue to the execution loop,
+ * which adds them as their arrival time comes up instead of loading the
+ * whole file first. Events go through a second SPSC queue to a formatter
+ * thread that prints them, so reading, scheduling and printing overlap.
+ *
+ * Programs arrive in time order, so every program arriving by the current
+ * time has been added once one arriving later has been. Critical paths only
+ * count successors that have been parsed, so on traces with dependencies CP
+ * may pick differently than it does when the whole file is loaded first.
+ *
+ * A stage stalls when it waits on a full or empty queue. Stalls are counted
+ * per stage and printed to stderr when the pipeline stops.
+*/
+
+#define PIPELINE_PROGRAM_CAPACITY 1024
+#define PIPELINE_EVENT_CAPACITY 4096
+
+/**
+ * @brief
+ * Opens the input file, starts the parser and formatter threads, and passes
+ * the process manager's events to the formatter.
+ * @param manager process manager handle
+ * @param filename input file
+ * @return
+ * Whether the input file could be opened. No threads are started if not.
+*/
+bool pipeline_start(process_manager manager, const char* filename);
+
+/**
+ * @brief
+ * Adds every parsed program that arrives by the current time, waiting on
+ * the parser if needed. Called before check_pending().
+ * @param manager process manager handle
+ * @return
+ * Whether more programs may still be added. The execution loop must not
+ * stop while this is TRUE.
+*/
+bool pipeline_admit(process_manager manager);
+
+/**
+ * @brief
+ * Waits for the formatter to print every event, stops both threads and
+ * prints stall counters. Fills in the fingerprint, size and parse time of
+ * the input file.
+ * @param pReport pointer to report
+*/
+void pipeline_stop(report* pReport);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef __PRIORITY_QUEUE_H__
+#define __PRIORITY_QUEUE_H__
+
+#include "defines.h"
+
+/**
+ * Binary min-heap of data pointers, ordered by a comparison function that 
+ * follows the same conventions as GNU cmp functions. Unlike the list, the 
+ * queue never frees the data it holds, so data must outlive the queue or be 
+ * popped before being freed.
+*/
+
+typedef struct priority_queue {
+    void** ppData;
+    uint32_t size;
+    uint32_t capacity;
+    int32_t (*cmp)(void*, void*);
+} priority_queue;
+
+/**
+ * @brief
+ * Creates an empty priority queue.
+ * @param cmp pointer to comparison function
+ * @return
+ * Heap allocated priority queue pointer
+*/
+priority_queue* priority_queue_create(int32_t (*cmp)(void*, void*));
+
+/**
+ * @brief
+ * Destroys priority queue and frees it from the heap. Also sets the value 
+ * of the pointer stored by ppQueue to NULL. Data inside the queue is NOT freed.
+ * @param ppQueue address of priority queue pointer
+*/
+void priority_queue_destroy(priority_queue** ppQueue);
+
+/**
+ * @brief
+ * Inserts data into the priority queue in O(log n) time.
+ * @param pQueue pointer to priority queue
+ * @param pData pointer to data
+*/
+void priority_queue_push(priority_queue* pQueue, void* pData);
+
+/**
+ * @param pQueue pointer to priority queue
+ * @return
+ * Smallest element in the queue, or NULL if the queue is empty.
+*/
+void* priority_queue_peek(priority_queue* pQueue);
+
+/**
+ * @brief
+ * Removes the smallest element from the queue in O(log n) time.
+ * @param pQueue pointer to priority queue
+ * @return
+ * Smallest element in the queue, or NULL if the queue is empty.
+*/
+void* priority_queue_pop(priority_queue* pQueue);
+
+#endif
@@ -2,54 +2,324 @@
 #define __PROCESS_MANAGER_H__
 
 #include "defines.h"
+#include "histogram.h"
 
 typedef enum memory_strategy {
     INFINITE,
     BEST_FIT
 } MEMORY_STRATEGY;
 
-typedef enum scheduler_type {
-    SJF,
-    RR,
-} SCHEDULER_TYPE;
+typedef struct scheduler scheduler;
+
+typedef enum report_flag {
+    REPORT_PERCENTILES = 1 << 0,
+    REPORT_BOUNDS = 1 << 1,
+    REPORT_ROUND_TRIP = 1 << 2,
+} REPORT_FLAG;
+
+typedef enum child_placement {
+    PLACE_ANY,      // Leave children to the host scheduler
+    PLACE_SAME,     // Pin children to the manager's CPU
+    PLACE_SIBLING,  // Pin children to a hyperthread sibling of the manager's CPU
+    PLACE_SPREAD    // Pin each new child to the next allowed CPU in turn
+} CHILD_PLACEMENT;
+
+#define CHILD_PLACEMENT_NAMES { "any", "same", "sibling", "spread" }
+
+/**
+ * Version 1 of the protocol with ./process sends the time, then signals the
+ * child with SIGTSTP, SIGCONT or SIGTERM, and waits for a stopped child with
+ * waitpid(). Version 2 is requested by passing --protocol=2 to the child, which
+ * then acknowledges START with a version byte after the usual verify byte.
+ * A child that only speaks version 1 ignores the flag and sends no version
+ * byte. If none arrives within PROTOCOL_VERSION_TIMEOUT_MS, the manager falls
+ * back to version 1 for the rest of the run. After START every message is an
+ * opcode byte followed by the time, STOP and CONTINUE are acknowledged with
+ * the last byte of the time, and the child waits for the next message in a
+ * blocking read instead of being stopped.
+ * Both versions hash the same bytes, so the sha of a process does not depend
+ * on the version. The emulated protocol (0) forks nothing and hashes the bytes
+ * a child would have hashed in the manager instead, which gives the same sha.
+*/
+typedef enum protocol_op {
+    OP_START = 0,
+    OP_STOP = 1,
+    OP_CONTINUE = 2,
+    OP_TERM = 3
+} PROTOCOL_OP;
+
+#define PROTOCOL_EMULATED 0
+#define PROTOCOL_SIGNALS 1
+#define PROTOCOL_MESSAGES 2
+#define PROTOCOL_VERSION_TIMEOUT_MS 1000
+
+/**
+ * @param manager_cpu CPU the manager is pinned to, or -1 to leave it unpinned
+ * @param placement where child processes are pinned, relative to the CPU the
+ * manager is pinned to or currently running on
+*/
+typedef struct affinity {
+    int32_t manager_cpu;
+    CHILD_PLACEMENT placement;
+} affinity;
+
+/**
+ * @param spawn simulated time taken to fork and exec a process' first run
+ * @param resume simulated time taken to resume a suspended process
+ * @param suspend simulated time taken to suspend a running process
+ * @param terminate simulated time taken to terminate a finished process
+*/
+typedef struct cost_model {
+    uint32_t spawn;
+    uint32_t resume;
+    uint32_t suspend;
+    uint32_t terminate;
+} cost_model;
 
 /**
  * @param name name of the program { Maximum of 8 characters }
  * @param time_arrived time program is ready to be allocated to the CPU
  * @param service_time total expected run-time of the program
  * @param memory_required  total memory required by the program during its run-time
+ * @param pBursts heap allocated array of alternating CPU and I/O burst lengths,
+ * starting and ending with a CPU burst. NULL if the program never blocks on I/O
+ * @param burst_count number of bursts in pBursts
+ * @param pDependsOn heap allocated comma separated names of programs that must 
+ * finish before this program is admitted. NULL if the program has no dependencies
+ * @param critical_path total service time of the longest chain of dependent
+ * programs that starts at this program, including its own service time
+ * @param index position of the program in the process manager, set when it 
+ * is added
 */
 typedef struct program {
     char name[MAX_NAME_LEN + 1]; // Add one for the null-terminating character
     uint32_t time_arrived; 
     uint32_t service_time;
     uint16_t memory_required;
+    uint32_t* pBursts;
+    uint32_t burst_count;
+    char* pDependsOn;
+    uint64_t critical_path;
+    uint32_t index;
 } program;
 
 /**
- * @param pPrograms dynamically allocated array of programs
+ * @param allocations number of successful allocations
+ * @param failed_allocations number of allocations that found no large enough block
+ * @param frees number of blocks returned to the free list
+ * @param merges number of adjacent free blocks merged together
+ * @param in_use memory currently allocated to processes in MB
+ * @param peak_in_use largest amount of memory allocated at once in MB
+ * @param free_memory total size of the blocks in the free list in MB
+ * @param free_blocks number of blocks in the free list
+ * @param largest_free size of the largest free block in MB
+ * @param fragmentation 1 - largest_free / total free memory, where 0 means all
+ * free memory is in one block
+*/
+typedef struct allocator_stats {
+    uint64_t allocations;
+    uint64_t failed_allocations;
+    uint64_t frees;
+    uint64_t merges;
+    uint32_t in_use;
+    uint32_t peak_in_use;
+    uint32_t free_memory;
+    uint32_t free_blocks;
+    uint32_t largest_free;
+    float fragmentation;
+} allocator_stats;
+
+/**
+ * @param service_time total simulated service time of finished processes
+ * @param user_seconds CPU time finished child processes spent in user mode
+ * @param system_seconds CPU time finished child processes spent in the kernel
+ * @param voluntary_switches context switches where a child process blocked,
+ * summed over finished child processes
+ * @param involuntary_switches context switches where a child process was 
+ * preempted, summed over finished child processes
+ * @param max_rss_kb largest resident set size of any finished child process
+*/
+typedef struct child_stats {
+    uint64_t service_time;
+    double user_seconds;
+    double system_seconds;
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
+    uint64_t max_rss_kb;
+} child_stats;
+
+/**
+ * @param program_count number of programs added to the process manager
+ * @param finished_count number of processes that have finished
+ * @param turnaround_time mean turnaround time, rounded up
+ * @param max_overhead largest time overhead of a finished process
+ * @param avg_overhead mean time overhead of finished processes
+ * @param makespan current simulation time
+ * @param cpu_utilisation fraction of simulation time spent running a process
+ * @param turnaround_bound lower bound of the mean turnaround time, rounded up.
+ * This is the mean turnaround of the offline preemptive shortest remaining 
+ * processing time schedule, which is optimal when I/O, memory, dependencies,
+ * quanta and costs are ignored
+ * @param makespan_bound lower bound of the makespan, which is the larger of
+ * the makespan of running every CPU burst back to back in arrival order, and
+ * the latest time any program could finish all of its bursts
+ * @param pTurnaround histogram of turnaround times
+ * @param pWaiting histogram of time spent neither running nor blocked on I/O
+ * @param pResponse histogram of time from arrival to first run
+ * @param pOverhead histogram of time overheads in hundredths
+ * @param pRoundTrip histogram of nanoseconds taken by each continue and 
+ * suspend exchange with a child process
+ * @param allocator memory allocator statistics
+ * @param children real resource usage of child processes, from wait4()
+*/
+typedef struct run_stats {
+    uint32_t program_count;
+    uint32_t finished_count;
+    uint32_t turnaround_time;
+    float max_overhead;
+    float avg_overhead;
+    uint32_t makespan;
+    float cpu_utilisation;
+    uint32_t turnaround_bound;
+    uint32_t makespan_bound;
+    histogram* pTurnaround;
+    histogram* pWaiting;
+    histogram* pResponse;
+    histogram* pOverhead;
+    histogram* pRoundTrip;
+    allocator_stats allocator;
+    child_stats children;
+} run_stats;
+
+/**
+ * @param time current simulation time
+ * @param program_count number of programs added to the process manager
+ * @param admitted_count number of programs admitted to the ready list
+ * @param finished_count number of processes that have finished
+ * @param input_depth number of programs waiting in the input list
+ * @param ready_depth number of processes in the ready list
+ * @param blocked_depth number of processes blocked on I/O
+ * @param live_children number of child processes that have been spawned and
+ * not yet terminated
+ * @param memory_in_use memory currently allocated to processes in MB
+ * @param tick_count number of calls to update()
+ * @param event_count number of events logged
+*/
+typedef struct run_gauges {
+    uint32_t time;
+    uint32_t program_count;
+    uint32_t admitted_count;
+    uint32_t finished_count;
+    uint32_t input_depth;
+    uint32_t ready_depth;
+    uint32_t blocked_depth;
+    uint32_t live_children;
+    uint32_t memory_in_use;
+    uint64_t tick_count;
+    uint64_t event_count;
+} run_gauges;
+
+/**
+ * @param time current simulation time
+ * @param input_depth number of programs waiting in the input list
+ * @param ready_depth number of processes in the ready list
+ * @param memory_in_use memory currently allocated to processes in MB
+ * @param largest_free size of the largest free block in MB
+ * @param running index of the running process' program, or -1 if 
+ * no process is running
+*/
+typedef struct run_sample {
+    uint32_t time;
+    uint32_t input_depth;
+    uint32_t ready_depth;
+    uint32_t memory_in_use;
+    uint32_t largest_free;
+    int32_t running;
+} run_sample;
+
+#define PROGRAM_CHUNK_BITS 10
+#define PROGRAM_CHUNK_SIZE (1 << PROGRAM_CHUNK_BITS)
+
+typedef enum event_type {
+    EVENT_READY,
+    EVENT_RUNNING,
+    EVENT_BLOCKED,
+    EVENT_FINISHED
+} EVENT_TYPE;
+
+/**
+ * Event printed to the output as a line of CSV, or passed to an event sink.
+ * @param type state the process entered
+ * @param time simulation time of the event
+ * @param value assigned memory index, remaining time, wake time or number of
+ * programs left for READY, RUNNING, BLOCKED and FINISHED events respectively
+ * @param name name of the process' program
+ * @param sha hash printed by the child, only set for FINISHED events
+*/
+typedef struct run_event {
+    EVENT_TYPE type;
+    uint32_t time;
+    uint32_t value;
+    char name[MAX_NAME_LEN + 1];
+    char sha[SHA_HASH_SIZE + 1];
+} run_event;
+
+/**
+ * @brief
+ * Receives events instead of the output stream.
+ * @param pEvent pointer to event, only valid during the call
+ * @param pContext context given to set_event_sink()
+*/
+typedef void (*event_sink)(const run_event* pEvent, void* pContext);
+
+/**
+ * @param ppProgramChunks dynamically allocated array of PROGRAM_CHUNK_SIZE 
+ * programs each. Programs never move once added, so pointers to them stay 
+ * valid while more programs are added
  * @param program_count number of programs added to process manager
  * @param pending_count number of programs in the input + active processes
- * @param type process manager's scheduler type
+ * @param pScheduler process manager's scheduler
+ * @param costs simulated time charged for each process state transition
+ * @param report_flags REPORT_FLAGs of extra statistics printed on destruction
+ * @param affinity CPU placement of the manager and its children
+ * @param protocol version of the protocol used to control child processes
+ * @param speculate whether the child of the next process is spawned ahead of
+ * its dispatch
+ * @param pOutput stream that events and final stats are printed to, or NULL
+ * @param sink optional, receives events instead of pOutput
+ * @param pSinkContext context passed to sink
 */
 typedef struct process_manager_t {
-    program* pPrograms;
+    program** ppProgramChunks;
     uint32_t program_count;
     uint32_t pending_count;
-    SCHEDULER_TYPE type;
+    const scheduler* pScheduler;
+    cost_model costs;
+    uint32_t report_flags;
+    affinity affinity;
+    uint32_t protocol;
+    bool speculate;
+    FILE* pOutput;
+    event_sink sink;
+    void* pSinkContext;
 } process_manager_t;
 
 typedef process_manager_t* process_manager;
 
 /**
  * @brief
- * Initialises process manager with a memory strategy and scheduler type.
+ * Initialises process manager with a memory strategy and scheduler.
+ * Process manager state is thread local, so each thread may initialise 
+ * its own process manager and run it independently of the others.
  * Assigns value at pManager to this initialised process manager instance.
  * @param pManager pointer to where process manager handle will be stored
+ * @param scheduler_name name of a built in scheduler (SJF, SJF-M, RR, CP) or path 
+ * to a shared object that exports a scheduler
+ * @param strategy desired memory strategy
 */
 void process_manager_initialise(
     process_manager* pManager, 
-    SCHEDULER_TYPE type, 
+    const char* scheduler_name, 
     MEMORY_STRATEGY strategy);
 
 /**
@@ -63,12 +333,118 @@ void process_manager_destroy(process_manager* pManager);
 
 /**
  * @brief
- * Adds a program to the the process manager
+ * Sets the simulated time charged when a process is first run, resumed,
+ * suspended and terminated. All costs are zero by default.
+ * @param manager process manager handle
+ * @param pCosts pointer to cost model
+*/
+void set_cost_model(process_manager manager, cost_model* pCosts);
+
+/**
+ * @brief
+ * Selects extra statistics to print after the final stats when the 
+ * process manager is destroyed.
+ * @param manager process manager handle
+ * @param report_flags bitwise or of REPORT_FLAGs
+*/
+void set_report_flags(process_manager manager, uint32_t report_flags);
+
+/**
+ * @brief
+ * Pins the manager to a CPU and selects where child processes are pinned.
+ * Exits the program if the manager cannot be pinned.
+ * @param manager process manager handle
+ * @param pAffinity pointer to affinity
+*/
+void set_affinity(process_manager manager, affinity* pAffinity);
+
+/**
+ * @brief
+ * Selects the version of the protocol used to control child processes. The
+ * default is PROTOCOL_SIGNALS. PROTOCOL_MESSAGES falls back to
+ * PROTOCOL_SIGNALS if the first child started does not answer with its
+ * version.
+ * @param manager process manager handle
+ * @param protocol PROTOCOL_EMULATED, PROTOCOL_SIGNALS or PROTOCOL_MESSAGES
+*/
+void set_protocol(process_manager manager, uint32_t protocol);
+
+/**
+ * @brief
+ * Enables speculative spawning. When the next dispatch is at most one quantum
+ * away, the child of the process the scheduler would pick next is forked and
+ * exec'd ahead of time, and only sent START when the process is really 
+ * dispatched. A child whose process is not picked is kept until its process
+ * runs. Simulated time and output are unchanged, only real spawn latency is
+ * hidden. The number of speculative spawns and of hits among them is printed
+ * to stderr at the end of the run.
+ * @param manager process manager handle
+ * @param speculate whether to spawn speculatively
+*/
+void set_speculation(process_manager manager, bool speculate);
+
+/**
+ * @brief
+ * Selects the stream events and final stats are printed to. The default is
+ * stdout.
+ * @param manager process manager handle
+ * @param pOutput stream to print to, or NULL to print nothing
+*/
+void set_output(process_manager manager, FILE* pOutput);
+
+/**
+ * @brief
+ * Passes events to a sink instead of printing them, so they can be formatted
+ * elsewhere. Final stats are still printed to the output stream.
+ * @param manager process manager handle
+ * @param sink function called with every event, or NULL to print events
+ * @param pContext context passed to sink
+*/
+void set_event_sink(process_manager manager, event_sink sink, void* pContext);
+
+/**
+ * @brief
+ * Prints an event as it appears in the output.
+ * @param fp stream to print to
+ * @param pEvent pointer to event
+*/
+void event_print(FILE* fp, const run_event* pEvent);
+
+/**
+ * @brief
+ * Parses a line of an input file in the format 
+ * "time_arrived name bursts memory_required [depends_on]", where bursts is 
+ * either the service time or a comma separated list of alternating CPU and I/O 
+ * burst lengths that starts and ends with a CPU burst, and the optional 
+ * depends_on column is a comma separated list of program names. Exits the
+ * program if the bursts are not lengths, or a field of the list is empty.
+ * @param line null-terminated line from the input file
+ * @param line_number line number of the line, starting from 1
+ * @param pProgram pointer to program that will hold the parsed values
+ * @return
+ * Whether or not the line contained a program. Blank lines are skipped.
+*/
+bool program_parse(char* line, uint32_t line_number, program* pProgram);
+
+/**
+ * @brief
+ * Adds a program to the the process manager. The process manager takes
+ * ownership of the program's burst array and dependency string. Programs
+ * can only depend on programs that were added before them.
  * @param manager process manager handle
  * @param pProgram pointer to program
 */
 void program_add(process_manager manager, program* pProgram);
 
+/**
+ * @param manager process manager handle
+ * @param index index of a program that has been added
+ * @return
+ * Pointer to the program, which stays valid until the process manager is
+ * destroyed
+*/
+program* program_at(process_manager manager, uint32_t index);
+
 /**
  * @param manager process manager handle
  * @return 
@@ -97,12 +473,40 @@ bool keep_process_running(process_manager manager);
 
 /**
  * @brief
- * Selects a new process to run based on the type of scheduler
- * assigned to the process manager at creation.
+ * Selects a new process to run using the scheduler assigned to the 
+ * process manager at creation.
  * @param manager process manager handle
 */
 void switch_process(process_manager manager);
 
+/**
+ * @brief
+ * Collects statistics about the simulation so far. Histograms in the
+ * statistics belong to the process manager and are only valid until it
+ * is destroyed.
+ * @param manager process manager handle
+ * @param pStats pointer to where statistics will be stored
+*/
+void process_manager_get_stats(process_manager manager, run_stats* pStats);
+
+/**
+ * @brief
+ * Collects gauges describing the simulation right now in O(1) time.
+ * @param manager process manager handle
+ * @param pGauges pointer to where gauges will be stored
+*/
+void process_manager_get_gauges(process_manager manager, run_gauges* pGauges);
+
+/**
+ * @brief
+ * Samples the queues and memory of the simulation right now. The largest free
+ * block is only recomputed if memory was allocated or freed since the last 
+ * sample.
+ * @param manager process manager handle
+ * @param pSample pointer to where the sample will be stored
+*/
+void process_manager_get_sample(process_manager manager, run_sample* pSample);
+
 /**
  * @brief
  * Updates simulation time of the process manager. Also updates run-time
@@ -0,0 +1,35 @@
+#ifndef __PROGRESS_H__
+#define __PROGRESS_H__
+
+#include "defines.h"
+#include "process_manager.h"
+
+/**
+ * Progress heartbeat for long runs. A SIGALRM interval timer sets 
+ * progress_due, so the execution loop only pays for a single load on ticks 
+ * where the heartbeat does not fire.
+*/
+
+extern volatile sig_atomic_t progress_due;
+
+/**
+ * @brief
+ * Starts a timer that sets progress_due every interval seconds.
+ * @param interval seconds between heartbeats
+*/
+void progress_start(double interval);
+
+/**
+ * @brief
+ * Prints a heartbeat line to stderr and clears progress_due.
+ * @param manager process manager handle
+*/
+void progress_report(process_manager manager);
+
+/**
+ * @brief
+ * Stops the heartbeat timer.
+*/
+void progress_stop();
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef __REPORT_H__
+#define __REPORT_H__
+
+#include "defines.h"
+#include "process_manager.h"
+
+/**
+ * Machine readable JSON report of a run, written with --report so that runs 
+ * can be compared without scraping the event log on stdout.
+*/
+
+#define FINGERPRINT_SEED 14695981039346656037ull
+
+/**
+ * @param filename input file
+ * @param scheduler_name name or path of the scheduler
+ * @param memory_strategy memory strategy
+ * @param quantum length of a quantum
+ * @param costs state transition costs
+ * @param affinity CPU placement of the manager and its children
+ * @param fingerprint FNV-1a hash of the input file's bytes
+ * @param trace_bytes size of the input file in bytes
+ * @param parse_seconds wall-clock time spent reading the input file
+ * @param simulate_seconds wall-clock time spent in the execution loop
+ * @param teardown_seconds wall-clock time spent printing final stats and 
+ * destroying the process manager
+ * @param stats statistics collected at the end of the execution loop
+ * @param histograms copies of the histograms in stats, which stay valid after
+ * the process manager is destroyed
+ * @param timings whether measurements of the host, which differ between runs
+ * of the same configuration, are written
+*/
+typedef struct report {
+    const char* filename;
+    const char* scheduler_name;
+    MEMORY_STRATEGY memory_strategy;
+    uint32_t quantum;
+    cost_model costs;
+    affinity affinity;
+    uint64_t fingerprint;
+    uint64_t trace_bytes;
+    double parse_seconds;
+    double simulate_seconds;
+    double teardown_seconds;
+    run_stats stats;
+    histogram histograms[5];
+    bool timings;
+} report;
+
+/**
+ * @brief
+ * Folds bytes into an FNV-1a hash.
+ * @param hash hash so far, starting with FINGERPRINT_SEED
+ * @param pData pointer to bytes
+ * @param nbytes number of bytes
+ * @return
+ * Updated hash
+*/
+uint64_t fingerprint_update(uint64_t hash, const void* pData, size_t nbytes);
+
+/**
+ * @return
+ * Wall-clock time in seconds from an arbitrary fixed point
+*/
+double wall_time();
+
+/**
+ * @brief
+ * Copies statistics into a report, including the histograms they point to.
+ * @param pReport pointer to report
+ * @param pStats pointer to statistics
+*/
+void report_set_stats(report* pReport, run_stats* pStats);
+
+/**
+ * @brief
+ * Prints a report as JSON, along with resource usage of the process and 
+ * its reaped children if timings are enabled.
+ * @param fp stream the report is printed to
+ * @param pReport pointer to report
+*/
+void report_print(FILE* fp, report* pReport);
+
+/**
+ * @brief
+ * Writes a report to a file with report_print(). Exits the program if the 
+ * file cannot be opened.
+ * @param path path of JSON file
+ * @param pReport pointer to report
+*/
+void report_write(const char* path, report* pReport);
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include "defines.h"
+#include "linked_list.h"
+#include "process_manager.h"
+
+/** Scheduler
+ * A scheduler is a table of hooks that the process manager calls while it
+ * runs. Built in schedulers are selected by name (SJF, SJF-M, RR, CP), and any
+ * other scheduler can be loaded from a shared object with -s path/to/policy.so.
+ * A shared object must export a scheduler called SCHEDULER_SYMBOL, and the
+ * SCHEDULER_ABI_VERSION it was built against as a const uint32_t called
+ * SCHEDULER_ABI_SYMBOL. Schedulers keep their own state statically, just like
+ * the process manager, and may read processes but should not modify them or
+ * the ready list.
+ *
+ * Plugins read process, program and scheduler directly, so fields are only
+ * ever appended to them. Moving, removing or retyping a field breaks every
+ * built plugin and must raise SCHEDULER_ABI_VERSION. Plugins also provide the
+ * scheduler itself, so appending to scheduler raises it too.
+*/
+
+#define SCHEDULER_SYMBOL "scheduler_plugin"
+#define SCHEDULER_ABI_SYMBOL "scheduler_abi_version"
+#define SCHEDULER_ABI_VERSION 2
+
+typedef enum process_state {
+    READY,
+    RUNNING,
+    BLOCKED,
+    FINISHED
+} PROCESS_STATE;
+
+typedef struct memory_block {
+    uint32_t index;
+    uint32_t size;
+} memory_block;
+
+typedef struct process {
+    program* pProgram;
+    uint32_t run_time;
+    uint32_t burst_index;   // Index of the current CPU burst in pProgram->pBursts
+    uint32_t burst_end;     // Run-time at which the current CPU burst ends
+    uint32_t wake_time;     // Time a BLOCKED process finishes its I/O burst
+    PROCESS_STATE state;
+    memory_block* pBlock;
+    pid_t child_pid;
+    int P2Cfd[2];   // Parent to Child File Descriptors
+    int C2Pfd[2];   // Child to Parent File Descriptors
+    char sha_buf[SHA_HASH_SIZE + 1];
+    uint32_t first_run_time;    // Time the process first started running
+    uint32_t blocked_time;      // Total time spent BLOCKED on I/O
+    uint32_t admitted_time;     // Time the process was admitted to the ready list
+    uint32_t ready_since;       // Time the process last entered the ready list
+    uint32_t ready_wait;        // Total time spent in the ready list
+    uint32_t suspend_count;     // Number of times the process was preempted
+    uint32_t block_count;       // Number of times the process blocked on I/O
+    bool speculative;   // Child was spawned ahead of dispatch and has not been sent START
+    uint8_t emulated_content[128];  // Bytes an emulated child would hash
+    size_t emulated_index;          // Where an emulated child stores its next byte
+} process;
+
+/**
+ * @param name name used to select the scheduler
+ * @param on_ready optional, called after a process is pushed to the tail
+ * of the ready list
+ * @param pick_next called with a non-empty ready list, returns the node of
+ * the process that should run next. With --speculate it is also called to 
+ * predict the next process without running it, so it must not change any 
+ * state
+ * @param on_tick optional, called after simulation time advances. pRunning
+ * is NULL if no process ran during the tick
+ * @param should_preempt optional, called before the running process is
+ * continued. Returning TRUE suspends the running process and pushes it to the
+ * tail of the ready list. Schedulers without this hook never preempt.
+ * @param uses_critical_path TRUE if pick_next reads program critical paths,
+ * which are only kept up to date for schedulers that set it
+*/
+typedef struct scheduler {
+    const char* name;
+    void (*on_ready)(process* pProcess);
+    node* (*pick_next)(list* pReady);
+    void (*on_tick)(process* pRunning, uint32_t time);
+    bool (*should_preempt)(process* pRunning, list* pReady);
+    bool uses_critical_path;
+} scheduler;
+
+/**
+ * @brief
+ * Estimates how much waiting memory would be admitted if a process finished
+ * now. The process' block is merged with its free neighbours, and the memory 
+ * required by every program in the input list that fits in the merged block but 
+ * not in the current largest free block is summed. Takes O(free blocks + input) 
+ * time. Provided by the process manager.
+ * @param pProcess pointer to an active process
+ * @return
+ * Memory in MB that finishing the process would unblock. Always 0 when the 
+ * memory strategy is infinite.
+*/
+uint32_t process_unblocked_memory(process* pProcess);
+
+/**
+ * @brief
+ * Finds a built in scheduler by name, or loads a scheduler from a shared
+ * object if name is a path. Exits the program if no scheduler can be found.
+ * @param name scheduler name or path to shared object
+ * @return
+ * Pointer to scheduler
+*/
+const scheduler* scheduler_find(const char* name);
+
+/**
+ * @brief
+ * Closes the shared object of a loaded scheduler, if there is one.
+*/
+void scheduler_unload();
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef __SHA256_H__
+#define __SHA256_H__
+
+#include "defines.h"
+
+/**
+ * SHA-256 (FIPS 180-4), used to emulate the hash child processes print when
+ * they are terminated. Input can be hashed in one call, or fed in pieces with
+ * sha256_update().
+*/
+
+#define SHA256_BLOCK_SIZE 64
+
+/**
+ * @param state intermediate hash value
+ * @param block bytes of the current block that have not been processed
+ * @param block_length number of bytes in block
+ * @param length total number of bytes hashed so far
+*/
+typedef struct sha256_context {
+    uint32_t state[8];
+    uint8_t block[SHA256_BLOCK_SIZE];
+    uint32_t block_length;
+    uint64_t length;
+} sha256_context;
+
+/**
+ * @brief
+ * Resets a context to the initial hash value.
+ * @param pContext pointer to context
+*/
+void sha256_init(sha256_context* pContext);
+
+/**
+ * @brief
+ * Hashes nbytes more bytes of input.
+ * @param pContext pointer to initialised context
+ * @param pBuf pointer to input
+ * @param nbytes number of bytes of input
+*/
+void sha256_update(sha256_context* pContext, const void* pBuf, size_t nbytes);
+
+/**
+ * @brief
+ * Pads the input and writes the hash as a null-terminated lowercase hex
+ * string. The context must be initialised again before it is reused.
+ * @param pContext pointer to initialised context
+ * @param hex buffer of SHA_HASH_SIZE + 1 characters
+*/
+void sha256_final(sha256_context* pContext, char hex[SHA_HASH_SIZE + 1]);
+
+/**
+ * @brief
+ * Hashes a buffer in one call.
+ * @param pBuf pointer to input
+ * @param nbytes number of bytes of input
+ * @param hex buffer of SHA_HASH_SIZE + 1 characters
+*/
+void sha256_hash(const void* pBuf, size_t nbytes, char hex[SHA_HASH_SIZE + 1]);
+
+#endif
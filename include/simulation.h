@@ -0,0 +1,83 @@
+#ifndef __SIMULATION_H__
+#define __SIMULATION_H__
+
+#include "defines.h"
+#include "process_manager.h"
+
+/**
+ * Quiet in-process simulations, for modes that simulate the same programs
+ * many times (Monte-Carlo evaluation and autotuning). Children are emulated
+ * and nothing is printed, so a simulation only costs the scheduling work.
+ * The process manager is thread local, so simulations may run on several
+ * threads at once.
+*/
+
+/**
+ * @param scheduler_name name or path of the scheduler
+ * @param strategy memory strategy
+ * @param quantum length of a quantum, must be greater than 0
+ * @param costs state transition costs
+*/
+typedef struct simulation_config {
+    const char* scheduler_name;
+    MEMORY_STRATEGY strategy;
+    uint32_t quantum;
+    cost_model costs;
+} simulation_config;
+
+/**
+ * @param turnaround_time mean turnaround time, without the rounding of the
+ * printed statistic
+ * @param avg_overhead mean time overhead
+ * @param max_overhead largest time overhead
+ * @param p99_overhead 99th percentile of time overhead
+ * @param makespan time the last process finished
+*/
+typedef struct simulation_result {
+    double turnaround_time;
+    double avg_overhead;
+    double max_overhead;
+    double p99_overhead;
+    uint32_t makespan;
+} simulation_result;
+
+/**
+ * @brief
+ * Reads every program of an input file. Exits the program if the file cannot
+ * be opened.
+ * @param filename input file
+ * @param pCount where the number of programs is stored
+ * @return
+ * Heap allocated array of programs, in the order of the file
+*/
+program* simulation_load(const char* filename, uint32_t* pCount);
+
+/**
+ * @brief
+ * Copies a program, including its burst array and dependency string.
+ * @param pDestination pointer to where the copy is stored
+ * @param pSource pointer to program
+*/
+void simulation_copy_program(program* pDestination, const program* pSource);
+
+/**
+ * @brief
+ * Frees an array of programs along with their burst arrays and dependency
+ * strings. Also sets the value of the pointer stored by ppPrograms to NULL.
+ * @param ppPrograms address of program array pointer
+ * @param count number of programs
+*/
+void simulation_free(program** ppPrograms, uint32_t count);
+
+/**
+ * @brief
+ * Simulates copies of the first count programs, which are left untouched.
+ * @param pPrograms pointer to programs, in arrival order
+ * @param count number of programs to simulate
+ * @param pConfig pointer to configuration
+ * @param pResult pointer to where the result is stored
+*/
+void simulation_run(const program* pPrograms, uint32_t count,
+    const simulation_config* pConfig, simulation_result* pResult);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+#include "defines.h"
+#include <stdatomic.h>
+
+/**
+ * Bounded lock-free queue of fixed size elements, for exactly one producer
+ * thread and one consumer thread. Elements are copied in and out of a ring
+ * whose capacity is a power of two. The producer only writes tail and the
+ * consumer only writes head, each on its own cache line, and each side keeps
+ * a cached copy of the other's index so it only reads the shared one when the
+ * ring looks full or empty. The producer may also close the queue, after
+ * which the consumer drains what is left.
+*/
+
+#define SPSC_CACHE_LINE 64
+
+typedef struct spsc_queue {
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t head;   // Next element to pop
+    size_t cached_tail;                             // Consumer's copy of tail
+    _Alignas(SPSC_CACHE_LINE) atomic_size_t tail;   // Next free slot
+    size_t cached_head;                             // Producer's copy of head
+    atomic_bool closed;
+    _Alignas(SPSC_CACHE_LINE) size_t capacity;
+    size_t element_size;
+    uint8_t* pBuffer;
+} spsc_queue;
+
+/**
+ * @brief
+ * Creates an empty queue.
+ * @param element_size size of each element in bytes
+ * @param capacity maximum number of elements, must be a power of two
+ * @return
+ * Heap allocated queue pointer
+*/
+spsc_queue* spsc_queue_create(size_t element_size, size_t capacity);
+
+/**
+ * @brief
+ * Destroys a queue and frees it from the heap. Also sets the value of the
+ * pointer stored by ppQueue to NULL.
+ * @param ppQueue address of queue pointer
+*/
+void spsc_queue_destroy(spsc_queue** ppQueue);
+
+/**
+ * @brief
+ * Copies an element to the tail of the queue. Only called by the producer.
+ * @param pQueue pointer to queue
+ * @param pElement pointer to element_size bytes
+ * @return
+ * Whether the element was pushed. FALSE if the queue is full.
+*/
+bool spsc_queue_try_push(spsc_queue* pQueue, const void* pElement);
+
+/**
+ * @brief
+ * Copies the element at the head of the queue out and removes it. Only
+ * called by the consumer.
+ * @param pQueue pointer to queue
+ * @param pElement pointer to where element_size bytes are copied
+ * @return
+ * Whether an element was popped. FALSE if the queue is empty.
+*/
+bool spsc_queue_try_pop(spsc_queue* pQueue, void* pElement);
+
+/**
+ * @brief
+ * Marks that no more elements will be pushed. Only called by the producer.
+ * @param pQueue pointer to queue
+*/
+void spsc_queue_close(spsc_queue* pQueue);
+
+/**
+ * @param pQueue pointer to queue
+ * @return
+ * Whether the queue is closed and every element has been popped. Only
+ * called by the consumer, after spsc_queue_try_pop() fails.
+*/
+bool spsc_queue_drained(spsc_queue* pQueue);
+
+#endif
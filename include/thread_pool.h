@@ -0,0 +1,37 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include "defines.h"
+
+/**
+ * Work-stealing thread pool for independent tasks numbered 0 to task_count - 1.
+ * Tasks are dealt round robin to per-thread deques, each thread takes tasks
+ * from the tail of its own deque, and a thread whose deque is empty steals
+ * from the head of the others. Tasks cannot add more tasks, so a thread stops
+ * once every deque is empty. Each thread has its own thread local process
+ * manager, so a task may run a whole simulation.
+*/
+
+/**
+ * @brief
+ * Runs a task.
+ * @param task index of the task
+ * @param pContext context given to thread_pool_run()
+*/
+typedef void (*thread_pool_task)(uint32_t task, void* pContext);
+
+/**
+ * @brief
+ * Runs every task and waits for them to finish. Exits the program if a
+ * thread cannot be created.
+ * @param task_count number of tasks
+ * @param thread_count number of threads, or 0 for one per online CPU. Never
+ * more threads than tasks are started.
+ * @param run function called once for every task
+ * @param pContext context passed to run
+ * @return
+ * Number of threads used
+*/
+uint32_t thread_pool_run(uint32_t task_count, uint32_t thread_count, thread_pool_task run, void* pContext);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef __TIMESERIES_H__
+#define __TIMESERIES_H__
+
+#include "defines.h"
+#include "process_manager.h"
+
+/**
+ * Time series of queue depths, memory use and the running process, written
+ * as CSV with --timeseries. Samples are taken after every scheduling 
+ * decision, or every --sample-interval units of simulated time, and samples 
+ * that only differ from the previous one in time are skipped, since the 
+ * series is a step function.
+ * 
+ * Samples are stored in a ring of fixed size blocks. The first sample of a 
+ * block is a keyframe encoded against zero, and every other sample is encoded
+ * as the zigzag varint deltas of its fields from the previous sample, so a 
+ * typical sample takes 6-8 bytes. When the ring is full the oldest block is 
+ * dropped, keeping the most recent TIMESERIES_BLOCK_COUNT blocks.
+*/
+
+#define TIMESERIES_BLOCK_SIZE 4096
+#define TIMESERIES_BLOCK_COUNT 256
+
+/**
+ * @brief
+ * Enables sampling.
+ * @param interval simulated time between samples, or 0 to sample after every
+ * scheduling decision
+*/
+void timeseries_enable(uint32_t interval);
+
+/**
+ * @brief
+ * Takes a sample if sampling is enabled and one is due.
+ * @param manager process manager handle
+*/
+void timeseries_sample(process_manager manager);
+
+/**
+ * @brief
+ * Decodes every sample in the ring, oldest first, and writes them to a CSV
+ * file. Frees the ring.
+ * @param path path of the CSV file
+ * @param manager process manager handle, used to name running processes
+*/
+void timeseries_write(const char* path, process_manager manager);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+/**
+ * Static tracepoints at the state transitions of processes and the allocator,
+ * under the provider name "allocate". When <sys/sdt.h> is available each 
+ * tracepoint is a USDT probe, which is a single nop until a tracer such as 
+ * bpftrace or perf attaches to it, so probes stay in release builds. Without 
+ * <sys/sdt.h>, or when built with -D NO_TRACEPOINTS, tracepoints compile to 
+ * nothing and their arguments are never evaluated.
+ * 
+ * Probes and their arguments:
+ *  admit(name, time, memory_index, memory_size)
+ *  run(name, time, remaining_time)
+ *  suspend(name, time, remaining_time)
+ *  continue(name, time, remaining_time), on every quantum a process resumes
+ *  terminate(name, time, turnaround)
+ *  alloc(size, memory_index)
+ *  free(memory_index, size)
+ *  merge(memory_index, size)
+*/
+
+#if !defined(NO_TRACEPOINTS) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define TRACEPOINTS_ENABLED
+#endif
+#endif
+
+#ifdef TRACEPOINTS_ENABLED
+#define TRACEPOINT2(probe, a, b) DTRACE_PROBE2(allocate, probe, a, b)
+#define TRACEPOINT3(probe, a, b, c) DTRACE_PROBE3(allocate, probe, a, b, c)
+#define TRACEPOINT4(probe, a, b, c, d) DTRACE_PROBE4(allocate, probe, a, b, c, d)
+#else
+#define TRACEPOINT2(probe, a, b) ((void)0)
+#define TRACEPOINT3(probe, a, b, c) ((void)0)
+#define TRACEPOINT4(probe, a, b, c, d) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+#include "scheduler.h"
+
+/** Shortest Remaining Time First
+ * Example scheduler plugin. Always runs the process with the least remaining
+ * service time, preempting the running process as soon as a shorter process
+ * becomes ready. Build with make plugins and run with -s plugins/srtf.so
+*/
+
+static uint32_t remaining_time(process* pProcess) {
+    return pProcess->pProgram->service_time - pProcess->run_time;
+}
+
+static node* srtf_pick_next(list* pReady) {
+    node* pChosen = pReady->head;
+    for (node* pNode = pReady->head->next; pNode != NULL; pNode = pNode->next) {
+        if (remaining_time(pNode->data) < remaining_time(pChosen->data)) {
+            pChosen = pNode;
+        }
+    }
+    return pChosen;
+}
+
+static bool srtf_should_preempt(process* pRunning, list* pReady) {
+    for (node* pNode = pReady->head; pNode != NULL; pNode = pNode->next) {
+        if (remaining_time(pNode->data) < remaining_time(pRunning)) 
+            return TRUE;
+    }
+    return FALSE;
+}
+
+const uint32_t scheduler_abi_version = SCHEDULER_ABI_VERSION;
+
+const scheduler scheduler_plugin = {
+    .name = "SRTF",
+    .pick_next = srtf_pick_next,
+    .should_preempt = srtf_should_preempt,
+};
@@ -23,9 +23,12 @@
 
 static long pid = 0;
 static int verbose_flag = 0;
+static int protocol = 1;
 typedef enum { STOP = 1, CONTINUE = 2, TERM = 3, START = 0 } Op;
 
 void read_store_dword(Op op, uint8_t hash_content[128], size_t* dest_index);
+Op read_store_message(uint8_t hash_content[128], size_t* dest_index);
+void write_byte(uint8_t byte);
 void store_process_name(const char* process_name, uint8_t hash_content[128],
 						size_t* dest_index);
 void sha256_hash(char hash_hexstring[65], const uint8_t* buf,
@@ -37,6 +40,7 @@ int main(int argc, char* argv[]) {
 	static struct option long_options[] = {
 		{"verbose", no_argument, &verbose_flag, 1},
 		{"help", no_argument, 0, 'h'},
+		{"protocol", required_argument, 0, 'p'},
 		{0, 0, 0, 0}};
 	int option_index;
 
@@ -51,7 +55,7 @@ int main(int argc, char* argv[]) {
 
 	while (1) {
 		option_index = 0;
-		c = getopt_long(argc, argv, "hv", long_options, &option_index);
+		c = getopt_long(argc, argv, "hvp:", long_options, &option_index);
 		if (c == -1) {
 			break;
 		}
@@ -59,8 +63,10 @@ int main(int argc, char* argv[]) {
 		switch (c) {
 		case 0: break;
 		case 'v': verbose_flag = 1; break;
+		case 'p': protocol = atoi(optarg); break;
 		case 'h':
-			printf("Usage: %s [-v|--verbose] <process-name>\n", argv[0]);
+			printf("Usage: %s [-v|--verbose] [--protocol=1|2] <process-name>\n",
+				   argv[0]);
 			exit(EXIT_SUCCESS);
 		}
 	}
@@ -79,6 +85,20 @@ int main(int argc, char* argv[]) {
 	dest_index = 0;
 	store_process_name(process_name, sha_content, &dest_index);
 
+	/* Protocol 2: opcodes arrive in-band and STOP is acknowledged, so the */
+	/* process parks in read() instead of being stopped by the kernel */
+	if (protocol == 2) {
+		read_store_dword(START, sha_content, &dest_index);
+		write_byte(2);
+		for (;;) {
+			if (read_store_message(sha_content, &dest_index) == TERM) {
+				sha256_hash(hash, sha_content, 128 - 9);
+				printf("%s\n", hash);
+				exit(EXIT_SUCCESS);
+			}
+		}
+	}
+
 	sigemptyset(&mask);
 	sigaddset(&mask, SIGINT);
 	sigaddset(&mask, SIGTERM);
@@ -208,17 +228,7 @@ void read_store_dword(Op op, uint8_t hash_content[128], size_t* dest_index) {
 
 	/* Need to prevent race condition between SIGCONT and SIGTERM */
 	if (op == CONTINUE || op == START) {
-		while (1) {
-			n = write(STDOUT_FILENO, &buf[4], 1);
-			if (n < 0) {
-				err(EXIT_FAILURE, "write");
-			}
-			if (n == 1) {
-				break;
-			}
-		}
-		fsync(STDOUT_FILENO);
-		fflush(stdout);
+		write_byte(buf[4]);
 	}
 	if (verbose_flag) {
 		fprintf(stderr, "[process.c (%ld)] wrote hex byte [%02x] to stdout\n",
@@ -228,6 +238,62 @@ void read_store_dword(Op op, uint8_t hash_content[128], size_t* dest_index) {
 	store(buf, 5, hash_content, dest_index);
 }
 
+/* Protocol 2 message: opcode followed by 4 (Big Endian) bytes */
+/* Hashes the same 5 bytes as read_store_dword */
+Op read_store_message(uint8_t hash_content[128], size_t* dest_index) {
+	uint8_t buf[5];
+	ssize_t n;
+	size_t len = 0;
+
+	while (len < 5) {
+		n = read(STDIN_FILENO, buf + len, 5 - len);
+		if (n < 0) {
+			err(EXIT_FAILURE, "read");
+		}
+		if (n == 0) {
+			fprintf(stderr, "[process.c (%ld)] Error: stdin closed\n", pid);
+			exit(EXIT_FAILURE);
+		}
+		len += n;
+	}
+	if (buf[0] != STOP && buf[0] != CONTINUE && buf[0] != TERM) {
+		fprintf(stderr, "[process.c (%ld)] Error: unexpected op %d\n", pid,
+				buf[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	if (verbose_flag) {
+		fprintf(stderr,
+				"[process.c (%ld)] op %d, time %d, hex bytes [%02x, %02x, "
+				"%02x, %02x]\n",
+				pid, buf[0],
+				((uint32_t)buf[1]) << 24 | ((uint32_t)buf[2]) << 16 |
+					((uint32_t)buf[3]) << 8 | (uint32_t)buf[4],
+				buf[1], buf[2], buf[3], buf[4]);
+	}
+
+	store(buf, 5, hash_content, dest_index);
+	if (buf[0] == STOP || buf[0] == CONTINUE) {
+		write_byte(buf[4]);
+	}
+	return buf[0];
+}
+
+void write_byte(uint8_t byte) {
+	ssize_t n;
+	while (1) {
+		n = write(STDOUT_FILENO, &byte, 1);
+		if (n < 0) {
+			err(EXIT_FAILURE, "write");
+		}
+		if (n == 1) {
+			break;
+		}
+	}
+	fsync(STDOUT_FILENO);
+	fflush(stdout);
+}
+
 /*****************************************************************************/
 /* SHA-256 Hashing, implemented by Steven Tang */
 /* Reference: RFC 6234 */
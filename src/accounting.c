@@ -0,0 +1,51 @@
+#include <accounting.h>
+#include <inttypes.h>
+
+static FILE* fp_accounting = NULL;
+
+void accounting_open(const char* path) {
+    assert(path != NULL);
+    assert(fp_accounting == NULL);
+
+    if ((fp_accounting = fopen(path, "w")) == NULL) {
+        err(EXIT_FAILURE, "%s", path);
+    }
+    fprintf(fp_accounting, "name,time_arrived,admitted_time,first_run_time,"
+        "suspend_count,block_count,ready_wait,finish_time,memory_index,memory_size,"
+        "service_time,user_seconds,system_seconds,voluntary_switches,involuntary_switches,max_rss_kb\n");
+}
+
+void accounting_write(accounting_record* pRecord) {
+    assert(pRecord != NULL);
+
+    if (fp_accounting == NULL) return;
+
+    fprintf(fp_accounting, "%s,%u,%u,%u,%u,%u,%u,%u,",
+        pRecord->name,
+        pRecord->time_arrived,
+        pRecord->admitted_time,
+        pRecord->first_run_time,
+        pRecord->suspend_count,
+        pRecord->block_count,
+        pRecord->ready_wait,
+        pRecord->finish_time);
+
+    // Processes run with infinite memory have no block to report
+    if (pRecord->memory_index >= 0) {
+        fprintf(fp_accounting, "%" PRId64, pRecord->memory_index);
+    }
+    fprintf(fp_accounting, ",%u,%u,%.6f,%.6f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n", 
+        pRecord->memory_size,
+        pRecord->service_time,
+        pRecord->user_seconds,
+        pRecord->system_seconds,
+        pRecord->voluntary_switches,
+        pRecord->involuntary_switches,
+        pRecord->max_rss_kb);
+}
+
+void accounting_close() {
+    if (fp_accounting == NULL) return;
+    fclose(fp_accounting);
+    fp_accounting = NULL;
+}
@@ -0,0 +1,192 @@
+#include "autotune.h"
+#include "report.h"
+#include "simulation.h"
+#include "thread_pool.h"
+#include <inttypes.h>
+
+// Prefixes are never shorter than this, so early rounds still see contention
+#define AUTOTUNE_MIN_PREFIX 8
+
+// Bounds on the fraction of candidates a round drops, as 1 - 1/reduction
+#define AUTOTUNE_MIN_REDUCTION 2.0
+#define AUTOTUNE_MAX_REDUCTION 4.0
+
+static const char* scheduler_names[] = { "SJF", "SJF-M", "RR", "CP" };
+static const MEMORY_STRATEGY strategies[] = { INFINITE, BEST_FIT };
+static const char* strategy_names[] = { "infinite", "best-fit" };
+static const uint32_t quanta[] = { 1, 2, 3, 5, 8, 10, 15, 20, 30 };
+#define AUTOTUNE_SCHEDULERS (sizeof(scheduler_names)/sizeof(scheduler_names[0]))
+#define AUTOTUNE_STRATEGIES (sizeof(strategies)/sizeof(strategies[0]))
+#define AUTOTUNE_QUANTA (sizeof(quanta)/sizeof(quanta[0]))
+#define AUTOTUNE_CANDIDATES (AUTOTUNE_SCHEDULERS*AUTOTUNE_STRATEGIES*AUTOTUNE_QUANTA)
+
+/**
+ * @param config configuration being tuned
+ * @param position index of the candidate in the search space
+ * @param score value of the objective in the latest round it ran
+*/
+typedef struct autotune_candidate {
+    simulation_config config;
+    uint32_t position;
+    double score;
+} autotune_candidate;
+
+/**
+ * @param pPrograms programs of the trace
+ * @param prefix number of programs simulated this round
+ * @param objective metric that is minimised
+ * @param pCandidates surviving candidates, best first after each round
+*/
+typedef struct autotune_context {
+    const program* pPrograms;
+    uint32_t prefix;
+    AUTOTUNE_OBJECTIVE objective;
+    autotune_candidate* pCandidates;
+} autotune_context;
+
+/**
+ * @brief
+ * Simulates a candidate on the prefix of the round and scores it. Called by
+ * the thread pool.
+ * @param candidate index of the candidate
+ * @param pContext pointer to autotune_context
+*/
+static void autotune_run_candidate(uint32_t candidate, void* pContext);
+
+/**
+ * @brief
+ * Orders candidates by score, then by their position in the search space,
+ * so ties are broken the same way on every run.
+ * @param pA pointer to first candidate
+ * @param pB pointer to second candidate
+ * @return
+ * Negative, zero or positive like strcmp()
+*/
+static int autotune_compare(const void* pA, const void* pB);
+
+bool autotune_parse_objective(const char* name, AUTOTUNE_OBJECTIVE* pObjective) {
+    assert(name != NULL);
+    assert(pObjective != NULL);
+
+    static const char* objective_names[] = AUTOTUNE_OBJECTIVE_NAMES;
+    for (uint32_t i=0; i<=OBJECTIVE_MAKESPAN; i++) {
+        if (strcmp(name, objective_names[i]) == 0) {
+            *pObjective = i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void autotune_run(const char* filename, const autotune_config* pConfig) {
+    assert(filename != NULL);
+    assert(pConfig != NULL);
+
+    uint32_t count = 0;
+    program* pPrograms = simulation_load(filename, &count);
+
+    // Candidates are laid out scheduler major, so ties favour earlier schedulers
+    autotune_candidate* pCandidates = malloc(sizeof(autotune_candidate)*AUTOTUNE_CANDIDATES);
+    for (uint32_t i=0; i<AUTOTUNE_CANDIDATES; i++) {
+        pCandidates[i].config = (simulation_config){
+            .scheduler_name = scheduler_names[i / (AUTOTUNE_STRATEGIES*AUTOTUNE_QUANTA)],
+            .strategy = strategies[i / AUTOTUNE_QUANTA % AUTOTUNE_STRATEGIES],
+            .quantum = quanta[i % AUTOTUNE_QUANTA],
+            .costs = pConfig->costs,
+        };
+        pCandidates[i].position = i;
+        pCandidates[i].score = 0;
+    }
+
+    // One round per doubling of the prefix, from the smallest prefix up to the
+    // whole trace, and never more rounds than halving to one candidate takes
+    uint32_t rounds = 1;
+    while (rounds < 1 + log2(AUTOTUNE_CANDIDATES) &&
+           (uint64_t)AUTOTUNE_MIN_PREFIX << rounds <= count) {
+        rounds++;
+    }
+
+    // Fewer rounds cut harder, but the last round always compares a few
+    double reduction = rounds > 1 ? pow(AUTOTUNE_CANDIDATES, 1.0/(rounds - 1)) : 1;
+    if (reduction < AUTOTUNE_MIN_REDUCTION) reduction = AUTOTUNE_MIN_REDUCTION;
+    if (reduction > AUTOTUNE_MAX_REDUCTION) reduction = AUTOTUNE_MAX_REDUCTION;
+
+    static const char* objective_names[] = AUTOTUNE_OBJECTIVE_NAMES;
+    printf("Autotune %s over %u configurations of %u programs in %u rounds\n",
+        objective_names[pConfig->objective], (uint32_t)AUTOTUNE_CANDIDATES, count, rounds);
+
+    autotune_context context = {
+        .pPrograms = pPrograms,
+        .objective = pConfig->objective,
+        .pCandidates = pCandidates,
+    };
+    uint64_t simulations = 0;
+    uint64_t simulated_programs = 0;
+    double start = wall_time();
+    for (uint32_t round=0; round<rounds; round++) {
+        // The prefix doubles every round, and the last round sees the whole trace
+        uint32_t prefix = count >> (rounds - 1 - round);
+        uint32_t survivors = ceil(AUTOTUNE_CANDIDATES / pow(reduction, round));
+
+        context.prefix = prefix;
+        thread_pool_run(survivors, pConfig->thread_count, autotune_run_candidate, &context);
+        qsort(pCandidates, survivors, sizeof(autotune_candidate), autotune_compare);
+        simulations += survivors;
+        simulated_programs += (uint64_t)survivors*prefix;
+
+        printf("Round %u prefix %u programs %u configurations best -s %s -m %s -q %u %s %.2f\n",
+            round + 1, prefix, survivors,
+            pCandidates[0].config.scheduler_name,
+            strategy_names[pCandidates[0].config.strategy],
+            pCandidates[0].config.quantum,
+            objective_names[pConfig->objective],
+            pCandidates[0].score);
+    }
+    double elapsed = wall_time() - start;
+
+    printf("Best -s %s -m %s -q %u %s %.2f\n",
+        pCandidates[0].config.scheduler_name,
+        strategy_names[pCandidates[0].config.strategy],
+        pCandidates[0].config.quantum,
+        objective_names[pConfig->objective],
+        pCandidates[0].score);
+
+    // Cost is compared with simulating every candidate on the whole trace
+    uint64_t exhaustive = (uint64_t)AUTOTUNE_CANDIDATES*count;
+    printf("Search cost %" PRIu64 " simulations of %" PRIu64 " programs, %.1f%% of an exhaustive search\n",
+        simulations, simulated_programs,
+        exhaustive > 0 ? 100.0*simulated_programs/exhaustive : 100.0);
+
+    // Timing varies between runs, so it goes to stderr like other diagnostics
+    fprintf(stderr, "Autotune searched in %.3fs\n", elapsed);
+
+    FREE(pCandidates);
+    simulation_free(&pPrograms, count);
+}
+
+static void autotune_run_candidate(uint32_t candidate, void* pContext) {
+    autotune_context* pAutotune = pContext;
+    autotune_candidate* pCandidate = &pAutotune->pCandidates[candidate];
+
+    simulation_result result;
+    simulation_run(pAutotune->pPrograms, pAutotune->prefix, &pCandidate->config, &result);
+    switch (pAutotune->objective) {
+        case OBJECTIVE_TURNAROUND:
+            pCandidate->score = result.turnaround_time;
+            break;
+        case OBJECTIVE_P99_OVERHEAD:
+            pCandidate->score = result.p99_overhead;
+            break;
+        case OBJECTIVE_MAKESPAN:
+            pCandidate->score = result.makespan;
+            break;
+    }
+}
+
+static int autotune_compare(const void* pA, const void* pB) {
+    const autotune_candidate* pFirst = pA;
+    const autotune_candidate* pSecond = pB;
+    if (pFirst->score != pSecond->score)
+        return pFirst->score < pSecond->score ? -1 : 1;
+    return pFirst->position < pSecond->position ? -1 : pFirst->position > pSecond->position;
+}
@@ -0,0 +1,350 @@
+#define _GNU_SOURCE // asprintf()
+
+#include "batch.h"
+#include "process_manager.h"
+#include "report.h"
+#include "thread_pool.h"
+
+#define BATCH_MAX_ARGS 32
+
+/**
+ * @param input_path trace the run reads
+ * @param expected_path file the output of the run must match
+ * @param scheduler_name name or path of the run's scheduler
+ * @param strategy memory strategy of the run
+ * @param quantum quantum of the run
+ * @param costs cost model of the run
+ * @param report_flags REPORT_FLAGs of the run
+ * @param protocol protocol used to control children
+ * @param speculate whether children are spawned speculatively
+ * @param line_number line of the manifest the run was read from
+ * @param passed whether the output matched
+ * @param pDifference heap allocated description of the first difference, or
+ * NULL if the run passed
+*/
+typedef struct batch_job {
+    char* input_path;
+    char* expected_path;
+    char scheduler_name[256];
+    MEMORY_STRATEGY strategy;
+    uint32_t quantum;
+    cost_model costs;
+    uint32_t report_flags;
+    uint32_t protocol;
+    bool speculate;
+    uint32_t line_number;
+    bool passed;
+    char* pDifference;
+} batch_job;
+
+// Shared by all workers, and only written before they start
+static batch_job* pJobs = NULL;
+static uint32_t job_count = 0;
+
+/**
+ * @brief
+ * Parses a manifest line into a job. Exits the program if the line is invalid.
+ * @param line null-terminated manifest line, which is modified
+ * @param line_number line number for error messages
+ * @param protocol protocol used if the line does not give one
+ * @param pJob pointer to job that will hold the parsed values
+ * @return
+ * Whether or not the line held a job. Blank lines and comments are skipped.
+*/
+static bool batch_parse_job(char* line, uint32_t line_number, uint32_t protocol, batch_job* pJob);
+
+/**
+ * @brief
+ * Simulates a job with output captured in memory, and compares it with the
+ * expected output. Called by the thread pool.
+ * @param job index of the job
+ * @param pContext unused
+*/
+static void batch_run_job(uint32_t job, void* pContext);
+
+/**
+ * @brief
+ * Reads a whole file into memory.
+ * @param path path to file
+ * @param pSize where the size of the file is stored
+ * @return
+ * Heap allocated, null-terminated contents, or NULL if the file cannot be read
+*/
+static char* batch_read_file(const char* path, size_t* pSize);
+
+/**
+ * @brief
+ * Describes the first line where two outputs differ.
+ * @param pExpected expected output
+ * @param pActual actual output
+ * @return
+ * Heap allocated description
+*/
+static char* batch_first_difference(const char* pExpected, const char* pActual);
+
+uint32_t batch_run(const char* manifest_path, uint32_t thread_count, uint32_t protocol) {
+    assert(manifest_path != NULL);
+
+    double start_time = wall_time();
+
+    // Read every job up front, so workers never touch the manifest
+    FILE* fp = fopen(manifest_path, "r");
+    if (fp == NULL) {
+        err(EXIT_FAILURE, "cannot open manifest %s", manifest_path);
+    }
+    uint32_t job_capacity = 0;
+    uint32_t line_number = 0;
+    char* line = NULL;
+    size_t line_size = 0;
+    while (getline(&line, &line_size, fp) != -1) {
+        line_number++;
+        batch_job job = {};
+        if (!batch_parse_job(line, line_number, protocol, &job))
+            continue;
+
+        if (job_count == job_capacity) {
+            job_capacity = job_capacity == 0 ? 16 : job_capacity*2;
+            pJobs = realloc(pJobs, sizeof(batch_job)*job_capacity);
+        }
+        pJobs[job_count++] = job;
+    }
+    FREE(line);
+    fclose(fp);
+
+    thread_count = thread_pool_run(job_count, thread_count, batch_run_job, NULL);
+
+    // Report failures in manifest order
+    uint32_t failed_count = 0;
+    for (uint32_t i=0; i<job_count; i++) {
+        batch_job* pJob = &pJobs[i];
+        if (!pJob->passed) {
+            failed_count++;
+            printf("FAIL %s:%u %s: %s\n",
+                manifest_path,
+                pJob->line_number,
+                pJob->input_path,
+                pJob->pDifference);
+        }
+        FREE(pJob->pDifference);
+        FREE(pJob->input_path);
+        FREE(pJob->expected_path);
+    }
+    printf("Batch %u runs %u passed %u failed on %u threads in %.3fs\n",
+        job_count,
+        job_count - failed_count,
+        failed_count,
+        thread_count,
+        wall_time() - start_time);
+
+    FREE(pJobs);
+    job_count = 0;
+    return failed_count;
+}
+
+static bool batch_parse_job(char* line, uint32_t line_number, uint32_t protocol, batch_job* pJob) {
+    assert(line != NULL);
+    assert(pJob != NULL);
+
+    char* args[BATCH_MAX_ARGS];
+    uint32_t arg_count = 0;
+    for (char* token = strtok(line, " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n")) {
+        if (arg_count == 0 && token[0] == '#')
+            return FALSE;
+        if (arg_count == BATCH_MAX_ARGS) {
+            errx(EXIT_FAILURE, "manifest line %u has too many arguments", line_number);
+        }
+        args[arg_count++] = token;
+    }
+    if (arg_count == 0)
+        return FALSE;
+    if (arg_count < 2) {
+        errx(EXIT_FAILURE, "manifest line %u needs an input and an expected output", line_number);
+    }
+
+    snprintf(pJob->scheduler_name, sizeof(pJob->scheduler_name), "SJF");
+    pJob->protocol = protocol;
+    pJob->line_number = line_number;
+    pJob->input_path = strdup(args[0]);
+    pJob->expected_path = strdup(args[arg_count - 1]);
+
+    // Flags sit between the input and the expected output
+    for (uint32_t i=1; i<arg_count - 1; i++) {
+        char* flag = args[i];
+        bool has_value = i + 1 < arg_count - 1;
+        if (strcmp(flag, "-s") == 0 && has_value) {
+            snprintf(pJob->scheduler_name, sizeof(pJob->scheduler_name), "%s", args[++i]);
+        } else if (strcmp(flag, "-m") == 0 && has_value) {
+            char* strategy = args[++i];
+            if (strcmp(strategy, "infinite") == 0) {
+                pJob->strategy = INFINITE;
+            } else if (strcmp(strategy, "best-fit") == 0) {
+                pJob->strategy = BEST_FIT;
+            } else {
+                errx(EXIT_FAILURE, "manifest line %u has unknown memory strategy: %s", line_number, strategy);
+            }
+        } else if (strcmp(flag, "-q") == 0 && has_value) {
+            char* end = NULL;
+            errno = 0;
+            long quantum = strtol(args[++i], &end, 10);
+            if (errno != 0 || *end != '\0' || quantum <= 0 || quantum > UINT32_MAX) {
+                errx(EXIT_FAILURE, "manifest line %u has invalid quantum: %s", line_number, args[i]);
+            }
+            pJob->quantum = quantum;
+        } else if (strcmp(flag, "-c") == 0 && has_value) {
+            cost_model* pCosts = &pJob->costs;
+            if (sscanf(args[++i], "%u,%u,%u,%u",
+                    &pCosts->spawn,
+                    &pCosts->resume,
+                    &pCosts->suspend,
+                    &pCosts->terminate) != 4) {
+                errx(EXIT_FAILURE, "manifest line %u has invalid costs: %s", line_number, args[i]);
+            }
+        } else if (strcmp(flag, "-P") == 0 || strcmp(flag, "--percentiles") == 0) {
+            pJob->report_flags |= REPORT_PERCENTILES;
+        } else if (strcmp(flag, "-B") == 0 || strcmp(flag, "--bounds") == 0) {
+            pJob->report_flags |= REPORT_BOUNDS;
+        } else if (strncmp(flag, "--protocol=", strlen("--protocol=")) == 0) {
+            pJob->protocol = strtoul(flag + strlen("--protocol="), NULL, 10);
+            if (pJob->protocol != PROTOCOL_EMULATED &&
+                pJob->protocol != PROTOCOL_SIGNALS &&
+                pJob->protocol != PROTOCOL_MESSAGES) {
+                errx(EXIT_FAILURE, "manifest line %u has invalid protocol: %s", line_number, flag);
+            }
+        } else if (strcmp(flag, "--speculate") == 0) {
+            pJob->speculate = TRUE;
+        } else {
+            errx(EXIT_FAILURE, "manifest line %u has unsupported flag: %s", line_number, flag);
+        }
+    }
+
+    // A simulation with a zero quantum never advances
+    if (pJob->quantum == 0) {
+        errx(EXIT_FAILURE, "manifest line %u needs a quantum", line_number);
+    }
+    return TRUE;
+}
+
+static void batch_run_job(uint32_t job, void* pContext) {
+    assert(job < job_count);
+
+    batch_job* pJob = &pJobs[job];
+    FILE* fp = fopen(pJob->input_path, "r");
+    if (fp == NULL) {
+        pJob->passed = FALSE;
+        pJob->pDifference = strdup("cannot open input");
+        return;
+    }
+
+    // Output goes to memory instead of stdout
+    char* pOutput = NULL;
+    size_t output_size = 0;
+    FILE* pStream = open_memstream(&pOutput, &output_size);
+    if (pStream == NULL) {
+        err(EXIT_FAILURE, "open_memstream");
+    }
+
+    process_manager manager = NULL;
+    process_manager_initialise(&manager, pJob->scheduler_name, pJob->strategy);
+    set_cost_model(manager, &pJob->costs);
+    set_report_flags(manager, pJob->report_flags);
+    set_protocol(manager, pJob->protocol);
+    set_speculation(manager, pJob->speculate);
+    set_output(manager, pStream);
+
+    char* line = NULL;
+    size_t line_size = 0;
+    uint32_t line_number = 0;
+    while (getline(&line, &line_size, fp) != -1) {
+        program new_program = {};
+        if (!program_parse(line, ++line_number, &new_program))
+            continue;
+
+        program_add(manager, &new_program);
+    }
+    FREE(line);
+    fclose(fp);
+
+    while (!should_terminate(manager)) {
+        check_pending(manager);
+        if (!keep_process_running(manager)) {
+            switch_process(manager);
+        }
+        update(manager, pJob->quantum);
+    }
+    process_manager_destroy(&manager);
+    fclose(pStream);
+
+    size_t expected_size = 0;
+    char* pExpected = batch_read_file(pJob->expected_path, &expected_size);
+    if (pExpected == NULL) {
+        pJob->passed = FALSE;
+        pJob->pDifference = strdup("cannot open expected output");
+    } else if (expected_size == output_size && memcmp(pExpected, pOutput, output_size) == 0) {
+        pJob->passed = TRUE;
+    } else {
+        pJob->passed = FALSE;
+        pJob->pDifference = batch_first_difference(pExpected, pOutput);
+    }
+    FREE(pExpected);
+    FREE(pOutput);
+}
+
+static char* batch_read_file(const char* path, size_t* pSize) {
+    assert(path != NULL);
+    assert(pSize != NULL);
+
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL)
+        return NULL;
+
+    size_t capacity = BUFFER_SIZE;
+    size_t size = 0;
+    char* pBuffer = malloc(capacity);
+    size_t bytes_read;
+    while ((bytes_read = fread(pBuffer + size, 1, capacity - size - 1, fp)) > 0) {
+        size += bytes_read;
+        if (size + 1 == capacity) {
+            capacity *= 2;
+            pBuffer = realloc(pBuffer, capacity);
+        }
+    }
+    fclose(fp);
+
+    pBuffer[size] = '\0';
+    *pSize = size;
+    return pBuffer;
+}
+
+static char* batch_first_difference(const char* pExpected, const char* pActual) {
+    assert(pExpected != NULL);
+    assert(pActual != NULL);
+
+    // Walk both outputs until the first differing line
+    uint32_t line_number = 1;
+    const char* pExpectedLine = pExpected;
+    const char* pActualLine = pActual;
+    while (*pExpected != '\0' && *pExpected == *pActual) {
+        if (*pExpected == '\n') {
+            line_number++;
+            pExpectedLine = pExpected + 1;
+            pActualLine = pActual + 1;
+        }
+        pExpected++;
+        pActual++;
+    }
+
+    int expected_length = strcspn(pExpectedLine, "\n");
+    int actual_length = strcspn(pActualLine, "\n");
+    char* pDifference = NULL;
+    if (*pExpectedLine == '\0') {
+        asprintf(&pDifference, "line %u: expected end of output, got \"%.*s\"",
+            line_number, actual_length, pActualLine);
+    } else if (*pActualLine == '\0') {
+        asprintf(&pDifference, "line %u: expected \"%.*s\", got end of output",
+            line_number, expected_length, pExpectedLine);
+    } else {
+        asprintf(&pDifference, "line %u: expected \"%.*s\", got \"%.*s\"",
+            line_number, expected_length, pExpectedLine, actual_length, pActualLine);
+    }
+    return pDifference;
+}
@@ -0,0 +1,344 @@
+#define _GNU_SOURCE // asprintf(), fopencookie()
+
+#include "cache.h"
+#include "sha256.h"
+#include <inttypes.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define CACHE_MAGIC "allocate-cache 1"
+#define CACHE_CHUNK_SIZE 65536
+
+/**
+ * @param path heap allocated path of the entry
+ * @param size size of the entry in bytes
+ * @param used time the entry was last written or replayed
+*/
+typedef struct cache_entry {
+    char* path;
+    uint64_t size;
+    struct timespec used;
+} cache_entry;
+
+static char* cache_directory = NULL;
+static uint64_t cache_max_bytes = 0;
+
+// Capture of the output of a run that missed
+static FILE* fp_capture = NULL;
+static FILE* fp_pass_through = NULL;
+static FILE* fp_captured = NULL;
+static char* pCaptured = NULL;
+static size_t captured_size = 0;
+
+/**
+ * @brief
+ * Write function of the capture stream, which writes to both the pass
+ * through stream and the captured output.
+ * @param pCookie unused
+ * @param pBuf pointer to bytes
+ * @param nbytes number of bytes
+ * @return
+ * Number of bytes written
+*/
+static ssize_t cache_tee_write(void* pCookie, const char* pBuf, size_t nbytes);
+
+/**
+ * @brief
+ * Folds the bytes of a file into a hash.
+ * @param pContext pointer to hash context
+ * @param filename file to hash
+ * @return
+ * Whether the whole file could be read
+*/
+static bool cache_hash_file(sha256_context* pContext, const char* filename);
+
+/**
+ * @brief
+ * Copies bytes from one stream to another.
+ * @param fp_from stream to read
+ * @param fp_to stream to write
+ * @param nbytes number of bytes
+ * @return
+ * Whether every byte was copied
+*/
+static bool cache_copy(FILE* fp_from, FILE* fp_to, uint64_t nbytes);
+
+/**
+ * @brief
+ * Removes the entries used least recently until the cache fits its size.
+ * @param keep_key key of an entry that is never removed
+*/
+static void cache_evict(const char* keep_key);
+
+/**
+ * @brief
+ * Orders entries from least to most recently used.
+ * @param pA pointer to first entry
+ * @param pB pointer to second entry
+ * @return
+ * Negative, zero or positive like strcmp()
+*/
+static int cache_entry_cmp(const void* pA, const void* pB);
+
+void cache_open(const char* directory, uint64_t max_bytes) {
+    assert(directory != NULL);
+    assert(cache_directory == NULL);
+
+    if (mkdir(directory, 0777) == -1 && errno != EEXIST) {
+        err(EXIT_FAILURE, "cannot create cache %s", directory);
+    }
+    cache_directory = strdup(directory);
+    cache_max_bytes = max_bytes;
+}
+
+bool cache_key(const char* filename, const char* plugin_path, const char* configuration, 
+    char key[SHA_HASH_SIZE + 1]) {
+    assert(filename != NULL);
+    assert(configuration != NULL);
+
+    // The plugin goes in as its own fixed size digest and the configuration
+    // ends at its null-terminating character, so neither can run into the input
+    char plugin_key[SHA_HASH_SIZE + 1] = {};
+    if (plugin_path != NULL) {
+        sha256_context plugin_context;
+        sha256_init(&plugin_context);
+        if (!cache_hash_file(&plugin_context, plugin_path))
+            return FALSE;
+        sha256_final(&plugin_context, plugin_key);
+    }
+
+    sha256_context context;
+    sha256_init(&context);
+    sha256_update(&context, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    sha256_update(&context, plugin_key, sizeof(plugin_key));
+    sha256_update(&context, configuration, strlen(configuration) + 1);
+    bool read_all = cache_hash_file(&context, filename);
+    sha256_final(&context, key);
+    return read_all;
+}
+
+bool cache_replay(const char* key, FILE* pOutput, const char* report_path) {
+    assert(cache_directory != NULL);
+    assert(key != NULL);
+    assert(pOutput != NULL);
+
+    char* path = NULL;
+    if (asprintf(&path, "%s/%s", cache_directory, key) == -1) {
+        err(EXIT_FAILURE, "asprintf");
+    }
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        FREE(path);
+        return FALSE;
+    }
+
+    // Entries are checked in full before any of them is written out
+    char header[128];
+    uint64_t output_bytes = 0;
+    uint64_t report_bytes = 0;
+    struct stat entry_stat;
+    bool valid = fgets(header, sizeof(header), fp) != NULL &&
+        sscanf(header, CACHE_MAGIC " %" SCNu64 " %" SCNu64, &output_bytes, &report_bytes) == 2 &&
+        fstat(fileno(fp), &entry_stat) == 0 &&
+        (uint64_t)entry_stat.st_size == (uint64_t)ftell(fp) + output_bytes + report_bytes &&
+        (report_path == NULL || report_bytes > 0);
+
+    if (valid) {
+        valid = cache_copy(fp, pOutput, output_bytes);
+    }
+    if (valid && report_path != NULL) {
+        FILE* fp_report = fopen(report_path, "w");
+        if (fp_report == NULL) {
+            err(EXIT_FAILURE, "%s", report_path);
+        }
+        valid = cache_copy(fp, fp_report, report_bytes);
+        fclose(fp_report);
+    }
+    fclose(fp);
+
+    // Replaying an entry makes it the most recently used
+    if (valid) {
+        utimensat(AT_FDCWD, path, NULL, 0);
+    }
+    FREE(path);
+    return valid;
+}
+
+FILE* cache_capture(FILE* pOutput) {
+    assert(pOutput != NULL);
+    assert(fp_capture == NULL);
+
+    fp_pass_through = pOutput;
+    if ((fp_captured = open_memstream(&pCaptured, &captured_size)) == NULL) {
+        err(EXIT_FAILURE, "open_memstream");
+    }
+    cookie_io_functions_t functions = { .write = cache_tee_write };
+    if ((fp_capture = fopencookie(NULL, "w", functions)) == NULL) {
+        err(EXIT_FAILURE, "fopencookie");
+    }
+
+    // Someone watching a terminal still sees each line as it is printed
+    if (isatty(fileno(pOutput))) {
+        setvbuf(fp_capture, NULL, _IOLBF, 0);
+    }
+    return fp_capture;
+}
+
+void cache_store(const char* key, report* pReport) {
+    assert(cache_directory != NULL);
+    assert(key != NULL);
+    assert(fp_capture != NULL);
+
+    fclose(fp_capture);
+    fp_capture = NULL;
+    fclose(fp_captured);
+    fp_captured = NULL;
+
+    // The entry gets its own copy of the report, printed without timings
+    char* pReported = NULL;
+    size_t report_size = 0;
+    if (pReport != NULL) {
+        FILE* fp_report = open_memstream(&pReported, &report_size);
+        if (fp_report == NULL) {
+            err(EXIT_FAILURE, "open_memstream");
+        }
+        bool timings = pReport->timings;
+        pReport->timings = FALSE;
+        report_print(fp_report, pReport);
+        pReport->timings = timings;
+        fclose(fp_report);
+    }
+
+    // Written under a name no other run uses, then renamed into place
+    char* path = NULL;
+    char* temporary_path = NULL;
+    if (asprintf(&path, "%s/%s", cache_directory, key) == -1 ||
+        asprintf(&temporary_path, "%s/.%s.%d.tmp", cache_directory, key, getpid()) == -1) {
+        err(EXIT_FAILURE, "asprintf");
+    }
+    FILE* fp = fopen(temporary_path, "wb");
+    bool written = fp != NULL;
+    if (written) {
+        written = fprintf(fp, CACHE_MAGIC " %" PRIu64 " %" PRIu64 "\n", (uint64_t)captured_size, (uint64_t)report_size) > 0 &&
+            fwrite(pCaptured, 1, captured_size, fp) == captured_size &&
+            fwrite(pReported, 1, report_size, fp) == report_size &&
+            fflush(fp) == 0 &&
+            fsync(fileno(fp)) == 0;
+        written = fclose(fp) == 0 && written;
+    }
+    if (!written || rename(temporary_path, path) == -1) {
+        warn("cannot write cache entry %s", path);
+        unlink(temporary_path);
+    }
+
+    FREE(path);
+    FREE(temporary_path);
+    FREE(pReported);
+    FREE(pCaptured);
+    captured_size = 0;
+
+    cache_evict(key);
+}
+
+static ssize_t cache_tee_write(void* pCookie, const char* pBuf, size_t nbytes) {
+    fwrite(pBuf, 1, nbytes, fp_pass_through);
+    fwrite(pBuf, 1, nbytes, fp_captured);
+    return nbytes;
+}
+
+static bool cache_hash_file(sha256_context* pContext, const char* filename) {
+    FILE* fp = fopen(filename, "rb");
+    if (fp == NULL)
+        return FALSE;
+
+    uint8_t* pChunk = malloc(CACHE_CHUNK_SIZE);
+    size_t bytes_read;
+    while ((bytes_read = fread(pChunk, 1, CACHE_CHUNK_SIZE, fp)) > 0) {
+        sha256_update(pContext, pChunk, bytes_read);
+    }
+    bool read_all = !ferror(fp);
+    FREE(pChunk);
+    fclose(fp);
+    return read_all;
+}
+
+static bool cache_copy(FILE* fp_from, FILE* fp_to, uint64_t nbytes) {
+    uint8_t* pChunk = malloc(CACHE_CHUNK_SIZE);
+    while (nbytes > 0) {
+        size_t chunk = nbytes < CACHE_CHUNK_SIZE ? nbytes : CACHE_CHUNK_SIZE;
+        if (fread(pChunk, 1, chunk, fp_from) != chunk || fwrite(pChunk, 1, chunk, fp_to) != chunk)
+            break;
+        nbytes -= chunk;
+    }
+    FREE(pChunk);
+    return nbytes == 0;
+}
+
+static void cache_evict(const char* keep_key) {
+    DIR* pDirectory = opendir(cache_directory);
+    if (pDirectory == NULL)
+        return;
+
+    // Only names that are keys are entries, which skips temporary files
+    cache_entry* pEntries = NULL;
+    uint32_t entry_count = 0;
+    uint32_t capacity = 0;
+    uint64_t total_bytes = 0;
+    struct dirent* pDirent;
+    while ((pDirent = readdir(pDirectory)) != NULL) {
+        if (strlen(pDirent->d_name) != SHA_HASH_SIZE ||
+            strspn(pDirent->d_name, "0123456789abcdef") != SHA_HASH_SIZE ||
+            strcmp(pDirent->d_name, keep_key) == 0)
+            continue;
+
+        cache_entry entry = {};
+        struct stat entry_stat;
+        if (asprintf(&entry.path, "%s/%s", cache_directory, pDirent->d_name) == -1) {
+            err(EXIT_FAILURE, "asprintf");
+        }
+        if (stat(entry.path, &entry_stat) == -1) {
+            FREE(entry.path);
+            continue;
+        }
+        entry.size = entry_stat.st_size;
+        entry.used = entry_stat.st_mtim;
+
+        if (entry_count == capacity) {
+            capacity = capacity == 0 ? 16 : capacity*2;
+            pEntries = realloc(pEntries, sizeof(cache_entry)*capacity);
+        }
+        pEntries[entry_count++] = entry;
+        total_bytes += entry.size;
+    }
+    closedir(pDirectory);
+
+    // The entry just written or replayed counts towards the size too
+    char* keep_path = NULL;
+    struct stat keep_stat;
+    if (asprintf(&keep_path, "%s/%s", cache_directory, keep_key) != -1 && stat(keep_path, &keep_stat) == 0) {
+        total_bytes += keep_stat.st_size;
+    }
+    FREE(keep_path);
+
+    if (entry_count > 1) {
+        qsort(pEntries, entry_count, sizeof(cache_entry), cache_entry_cmp);
+    }
+    for (uint32_t i=0; i<entry_count; i++) {
+        if (total_bytes > cache_max_bytes && unlink(pEntries[i].path) == 0) {
+            total_bytes -= pEntries[i].size;
+        }
+        FREE(pEntries[i].path);
+    }
+    FREE(pEntries);
+}
+
+static int cache_entry_cmp(const void* pA, const void* pB) {
+    const cache_entry* pFirst = pA;
+    const cache_entry* pSecond = pB;
+    if (pFirst->used.tv_sec != pSecond->used.tv_sec)
+        return pFirst->used.tv_sec < pSecond->used.tv_sec ? -1 : 1;
+    if (pFirst->used.tv_nsec != pSecond->used.tv_nsec)
+        return pFirst->used.tv_nsec < pSecond->used.tv_nsec ? -1 : 1;
+    return strcmp(pFirst->path, pSecond->path);
+}
@@ -0,0 +1,674 @@
+#define _GNU_SOURCE // accept4()
+
+#include "cluster.h"
+#include "histogram.h"
+#include "report.h"
+#include "simulation.h"
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// How long the coordinator waits for a connection before checking on workers
+#define CLUSTER_ACCEPT_POLL_MILLISECONDS 100
+#define CLUSTER_DIRECTORY_TEMPLATE "/tmp/allocate-cluster-XXXXXX"
+
+typedef enum cluster_message {
+    MESSAGE_ARRIVE,     // Coordinator sends a program, followed by its bursts and dependencies
+    MESSAGE_ACK,        // Worker has added the program
+    MESSAGE_STEP,       // Coordinator steps the node up to and including a time
+    MESSAGE_STATUS,     // Worker reports its state after a step
+    MESSAGE_FINISH,     // Coordinator asks for the statistics of the node
+    MESSAGE_STATS,      // Worker reports its statistics and exits
+} CLUSTER_MESSAGE;
+
+/**
+ * Payload of MESSAGE_ARRIVE, followed by burst_count bursts and depends_length
+ * bytes of comma separated predecessor names.
+*/
+typedef struct cluster_arrival {
+    char name[MAX_NAME_LEN + 1];
+    uint32_t time_arrived;
+    uint32_t service_time;
+    uint32_t memory_required;
+    uint32_t burst_count;
+    uint32_t depends_length;
+} cluster_arrival;
+
+/**
+ * Payload of MESSAGE_STATUS.
+ * @param time simulation time of the node
+ * @param finished_count number of processes that have finished
+ * @param input_depth number of programs waiting for memory
+ * @param memory_in_use memory allocated to processes in MB
+ * @param idle whether every program sent to the node has finished
+*/
+typedef struct cluster_status {
+    uint32_t time;
+    uint32_t finished_count;
+    uint32_t input_depth;
+    uint32_t memory_in_use;
+    uint32_t idle;
+} cluster_status;
+
+/**
+ * Payload of MESSAGE_STATS.
+ * @param program_count number of programs sent to the node
+ * @param turnaround_sum sum of turnaround times
+ * @param overhead_sum sum of time overheads
+ * @param max_overhead largest time overhead
+ * @param makespan time the last process of the node finished
+*/
+typedef struct cluster_stats {
+    uint32_t program_count;
+    uint64_t turnaround_sum;
+    double overhead_sum;
+    float max_overhead;
+    uint32_t makespan;
+} cluster_stats;
+
+/**
+ * @param fd connection to the worker
+ * @param dispatched_count number of programs sent to the node
+ * @param reserved_memory memory of programs sent since the last status
+ * @param stepped whether the node is stepped this tick
+ * @param status latest status of the node
+ * @param stats final statistics of the node
+*/
+typedef struct cluster_node {
+    int fd;
+    uint32_t dispatched_count;
+    uint32_t reserved_memory;
+    bool stepped;
+    cluster_status status;
+    cluster_stats stats;
+} cluster_node;
+
+/**
+ * @brief
+ * Writes a whole buffer to a socket. Exits the program on failure.
+ * @param fd socket
+ * @param pBuf pointer to buffer
+ * @param nbytes number of bytes
+*/
+static void cluster_write(int fd, const void* pBuf, size_t nbytes);
+
+/**
+ * @brief
+ * Reads a whole buffer from a socket. Exits the program on failure or if the
+ * other end has closed the connection.
+ * @param fd socket
+ * @param pBuf pointer to buffer
+ * @param nbytes number of bytes
+*/
+static void cluster_read(int fd, void* pBuf, size_t nbytes);
+
+/**
+ * @brief
+ * Sends a message with a fixed size payload in one write.
+ * @param fd socket
+ * @param type type of message
+ * @param pPayload pointer to payload, or NULL if nbytes is 0
+ * @param nbytes size of payload
+*/
+static void cluster_send(int fd, CLUSTER_MESSAGE type, const void* pPayload, size_t nbytes);
+
+/**
+ * @brief
+ * Receives a message with a fixed size payload. Exits the program if the
+ * message is of another type.
+ * @param fd socket
+ * @param type expected type of message
+ * @param pPayload pointer to where the payload is stored
+ * @param nbytes size of payload
+*/
+static void cluster_expect(int fd, CLUSTER_MESSAGE type, void* pPayload, size_t nbytes);
+
+/**
+ * @brief
+ * Starts a worker that connects to the coordinator's socket.
+ * @param socket_path path of the coordinator's socket
+ * @param pConfig pointer to configuration
+ * @return
+ * Process id of the worker
+*/
+static pid_t cluster_spawn(const char* socket_path, const cluster_config* pConfig);
+
+/**
+ * @brief
+ * Groups the programs of a trace into the connected components of their
+ * dependencies. Exits the program if a program depends on one that was not
+ * added before it.
+ * @param pPrograms pointer to programs of the trace
+ * @param count number of programs
+ * @return
+ * Heap allocated array holding, for every program, the index of the first
+ * program of its component
+*/
+static uint32_t* cluster_components(const program* pPrograms, uint32_t count);
+
+/**
+ * @brief
+ * Finds the first program of the component of a program while components
+ * are being joined, halving the path to it.
+ * @param pFirst first program of the component of every program so far
+ * @param index index of the program
+ * @return
+ * Index of the first program of the component
+*/
+static uint32_t cluster_component_find(uint32_t* pFirst, uint32_t index);
+
+/**
+ * @brief
+ * Chooses the node a program is sent to.
+ * @param pNodes pointer to nodes
+ * @param pConfig pointer to configuration
+ * @param pProgram pointer to program
+ * @param pNodeOf node of every program already sent
+ * @param first index of the first program of the component of the program
+ * @param index index of the program
+ * @param pRoundRobin pointer to next node of round robin
+ * @return
+ * Index of the node
+*/
+static uint32_t cluster_choose(cluster_node* pNodes, const cluster_config* pConfig,
+    const program* pProgram, const uint32_t* pNodeOf, uint32_t first, uint32_t index, uint32_t* pRoundRobin);
+
+/**
+ * @brief
+ * Sends a program to a node and waits until the node has added it.
+ * @param pNode pointer to node
+ * @param pProgram pointer to program
+*/
+static void cluster_dispatch(cluster_node* pNode, const program* pProgram);
+
+bool cluster_parse_policy(const char* name, BALANCE_POLICY* pPolicy) {
+    assert(name != NULL);
+    assert(pPolicy != NULL);
+
+    static const char* policy_names[] = BALANCE_POLICY_NAMES;
+    for (uint32_t i=0; i<=BALANCE_MEMORY_AWARE; i++) {
+        if (strcmp(name, policy_names[i]) == 0) {
+            *pPolicy = i;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void cluster_coordinate(const char* filename, const cluster_config* pConfig) {
+    assert(filename != NULL);
+    assert(pConfig != NULL);
+
+    if (pConfig->node_count == 0) {
+        errx(EXIT_FAILURE, "a cluster needs at least 1 node");
+    }
+    if (pConfig->quantum == 0) {
+        errx(EXIT_FAILURE, "a cluster needs a quantum");
+    }
+
+    uint32_t count = 0;
+    program* pPrograms = simulation_load(filename, &count);
+    uint32_t* pNodeOf = malloc(sizeof(uint32_t)*(count > 0 ? count : 1));
+    uint32_t* pComponents = cluster_components(pPrograms, count);
+
+    // Workers connect back to a socket in a directory only this coordinator 
+    // can use, so no other user can take its name first
+    char directory[] = CLUSTER_DIRECTORY_TEMPLATE;
+    if (mkdtemp(directory) == NULL) {
+        err(EXIT_FAILURE, "mkdtemp");
+    }
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/socket", directory);
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        err(EXIT_FAILURE, "socket");
+    }
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        err(EXIT_FAILURE, "bind %s", addr.sun_path);
+    }
+    if (listen(listen_fd, pConfig->node_count) == -1) {
+        err(EXIT_FAILURE, "listen");
+    }
+
+    cluster_node* pNodes = calloc(pConfig->node_count, sizeof(cluster_node));
+    pid_t* pWorkers = malloc(sizeof(pid_t)*pConfig->node_count);
+    for (uint32_t i=0; i<pConfig->node_count; i++) {
+        pWorkers[i] = cluster_spawn(addr.sun_path, pConfig);
+        pNodes[i].status.idle = TRUE;
+    }
+
+    // Nodes are numbered in the order their workers connect, which does not
+    // matter since every worker is the same
+    for (uint32_t accepted = 0; accepted < pConfig->node_count; ) {
+        struct pollfd listener = { .fd = listen_fd, .events = POLLIN };
+        if (poll(&listener, 1, CLUSTER_ACCEPT_POLL_MILLISECONDS) <= 0) {
+            if (waitpid(-1, NULL, WNOHANG) > 0) {
+                unlink(addr.sun_path);
+                rmdir(directory);
+                errx(EXIT_FAILURE, "cluster worker exited before connecting");
+            }
+            continue;
+        }
+        if ((pNodes[accepted].fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC)) == -1) {
+            err(EXIT_FAILURE, "accept");
+        }
+        accepted++;
+    }
+    close(listen_fd);
+    unlink(addr.sun_path);
+    rmdir(directory);
+
+    histogram dispatch_histogram = {};
+    uint32_t next = 0;
+    uint32_t round_robin = 0;
+    uint32_t time = 0;
+    double start = wall_time();
+    while (TRUE) {
+        bool all_idle = TRUE;
+        for (uint32_t i=0; i<pConfig->node_count; i++) {
+            pNodes[i].stepped = !pNodes[i].status.idle;
+            all_idle = all_idle && pNodes[i].status.idle;
+        }
+        if (all_idle && next == count)
+            break;
+
+        // Ticks where every node is idle are skipped, up to the next arrival
+        if (all_idle) {
+            uint32_t arrival_tick = (pPrograms[next].time_arrived + pConfig->quantum - 1) /
+                pConfig->quantum * pConfig->quantum;
+            if (arrival_tick > time) {
+                time = arrival_tick;
+            }
+        }
+
+        // Programs are sent before the tick that admits them, like check_pending()
+        while (next < count && pPrograms[next].time_arrived <= time) {
+            double dispatch_start = wall_time();
+            uint32_t chosen = cluster_choose(pNodes, pConfig, &pPrograms[next], pNodeOf, 
+                pComponents[next], next, &round_robin);
+            cluster_dispatch(&pNodes[chosen], &pPrograms[next]);
+            histogram_record(&dispatch_histogram, (uint64_t)((wall_time() - dispatch_start)*1e9));
+            pNodeOf[next] = chosen;
+            next++;
+        }
+
+        // Every node steps before any status is read, so nodes run in parallel
+        for (uint32_t i=0; i<pConfig->node_count; i++) {
+            if (pNodes[i].stepped) {
+                cluster_send(pNodes[i].fd, MESSAGE_STEP, &time, sizeof(time));
+            }
+        }
+        for (uint32_t i=0; i<pConfig->node_count; i++) {
+            if (pNodes[i].stepped) {
+                cluster_expect(pNodes[i].fd, MESSAGE_STATUS, &pNodes[i].status, sizeof(cluster_status));
+                pNodes[i].reserved_memory = 0;
+            }
+        }
+        time += pConfig->quantum;
+    }
+    double elapsed = wall_time() - start;
+
+    for (uint32_t i=0; i<pConfig->node_count; i++) {
+        cluster_send(pNodes[i].fd, MESSAGE_FINISH, NULL, 0);
+        cluster_expect(pNodes[i].fd, MESSAGE_STATS, &pNodes[i].stats, sizeof(cluster_stats));
+        close(pNodes[i].fd);
+    }
+
+    // Only now has every worker been told to finish, since a node is not
+    // necessarily the worker spawned in the same position
+    for (uint32_t i=0; i<pConfig->node_count; i++) {
+        int status;
+        if (waitpid(pWorkers[i], &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            errx(EXIT_FAILURE, "cluster worker %d failed", pWorkers[i]);
+        }
+    }
+    FREE(pWorkers);
+
+    // Cluster statistics combine the nodes as if they were one run
+    static const char* policy_names[] = BALANCE_POLICY_NAMES;
+    printf("Cluster %u nodes balance %s\n", pConfig->node_count, policy_names[pConfig->policy]);
+    uint64_t turnaround_sum = 0;
+    double overhead_sum = 0;
+    float max_overhead = 0;
+    uint32_t makespan = 0;
+    for (uint32_t i=0; i<pConfig->node_count; i++) {
+        cluster_stats* pStats = &pNodes[i].stats;
+        uint32_t node_count = pStats->program_count > 0 ? pStats->program_count : 1;
+        printf("Node %u processes %u turnaround %u overhead %.2f %.2f makespan %u\n",
+            i, pStats->program_count,
+            (uint32_t)ceilf(pStats->turnaround_sum / (float)node_count),
+            pStats->max_overhead, pStats->overhead_sum / node_count,
+            pStats->makespan);
+
+        turnaround_sum += pStats->turnaround_sum;
+        overhead_sum += pStats->overhead_sum;
+        if (pStats->max_overhead > max_overhead) max_overhead = pStats->max_overhead;
+        if (pStats->makespan > makespan) makespan = pStats->makespan;
+    }
+    uint32_t program_count = count > 0 ? count : 1;
+    printf("Turnaround time %u\n", (uint32_t)ceilf(turnaround_sum / (float)program_count));
+    printf("Time overhead %.2f %.2f\n", max_overhead, overhead_sum / program_count);
+    printf("Makespan %u\n", makespan);
+
+    // Timing varies between runs, so it goes to stderr like other diagnostics
+    fprintf(stderr, "Cluster dispatched %u programs in %.3fs\n", count, elapsed);
+    fprintf(stderr, "Dispatch overhead us mean %.1f p50 %.1f p99 %.1f max %.1f\n",
+        dispatch_histogram.total > 0 ? dispatch_histogram.sum / 1000.0 / dispatch_histogram.total : 0.0,
+        histogram_percentile(&dispatch_histogram, 50) / 1000.0,
+        histogram_percentile(&dispatch_histogram, 99) / 1000.0,
+        dispatch_histogram.max / 1000.0);
+
+    FREE(pNodes);
+    FREE(pNodeOf);
+    FREE(pComponents);
+    simulation_free(&pPrograms, count);
+}
+
+void cluster_work(const char* socket_path, const cluster_config* pConfig) {
+    assert(socket_path != NULL);
+    assert(pConfig != NULL);
+
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        errx(EXIT_FAILURE, "cluster socket path too long: %s", socket_path);
+    }
+    strcpy(addr.sun_path, socket_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        err(EXIT_FAILURE, "socket");
+    }
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        err(EXIT_FAILURE, "connect %s", socket_path);
+    }
+
+    process_manager manager = NULL;
+    process_manager_initialise(&manager, pConfig->scheduler_name, pConfig->strategy);
+    cost_model costs = pConfig->costs;
+    set_cost_model(manager, &costs);
+    set_protocol(manager, pConfig->protocol);
+    set_output(manager, NULL);
+
+    bool finished = FALSE;
+    while (!finished) {
+        uint32_t type;
+        cluster_read(fd, &type, sizeof(type));
+        switch (type) {
+            case MESSAGE_ARRIVE: {
+                cluster_arrival arrival;
+                cluster_read(fd, &arrival, sizeof(arrival));
+
+                // The process manager takes ownership of bursts and dependencies
+                program new_program = {};
+                memcpy(new_program.name, arrival.name, sizeof(new_program.name));
+                new_program.name[MAX_NAME_LEN] = '\0';
+                new_program.time_arrived = arrival.time_arrived;
+                new_program.service_time = arrival.service_time;
+                new_program.memory_required = arrival.memory_required;
+                new_program.burst_count = arrival.burst_count;
+                if (arrival.burst_count > 0) {
+                    new_program.pBursts = malloc(sizeof(uint32_t)*arrival.burst_count);
+                    cluster_read(fd, new_program.pBursts, sizeof(uint32_t)*arrival.burst_count);
+                }
+                if (arrival.depends_length > 0) {
+                    new_program.pDependsOn = malloc(arrival.depends_length + 1);
+                    cluster_read(fd, new_program.pDependsOn, arrival.depends_length);
+                    new_program.pDependsOn[arrival.depends_length] = '\0';
+                }
+                program_add(manager, &new_program);
+                cluster_send(fd, MESSAGE_ACK, NULL, 0);
+                break;
+            }
+            case MESSAGE_STEP: {
+                uint32_t until;
+                cluster_read(fd, &until, sizeof(until));
+
+                // A node that was idle catches up on the ticks it skipped
+                run_gauges gauges;
+                process_manager_get_gauges(manager, &gauges);
+                while (gauges.time <= until && !should_terminate(manager)) {
+                    check_pending(manager);
+                    if (!keep_process_running(manager)) {
+                        switch_process(manager);
+                    }
+                    update(manager, pConfig->quantum);
+                    process_manager_get_gauges(manager, &gauges);
+                }
+
+                cluster_status status = {
+                    .time = gauges.time,
+                    .finished_count = gauges.finished_count,
+                    .input_depth = gauges.input_depth,
+                    .memory_in_use = gauges.memory_in_use,
+                    .idle = should_terminate(manager),
+                };
+                cluster_send(fd, MESSAGE_STATUS, &status, sizeof(status));
+                break;
+            }
+            case MESSAGE_FINISH: {
+                run_stats stats;
+                process_manager_get_stats(manager, &stats);
+                cluster_stats node_stats = {
+                    .program_count = stats.program_count,
+                    .turnaround_sum = stats.pTurnaround->sum,
+                    .overhead_sum = stats.program_count > 0 ? (double)stats.avg_overhead*stats.program_count : 0,
+                    .max_overhead = stats.max_overhead,
+                    .makespan = stats.makespan,
+                };
+                cluster_send(fd, MESSAGE_STATS, &node_stats, sizeof(node_stats));
+                finished = TRUE;
+                break;
+            }
+            default:
+                errx(EXIT_FAILURE, "unknown cluster message %u", type);
+        }
+    }
+
+    process_manager_destroy(&manager);
+    close(fd);
+}
+
+static void cluster_write(int fd, const void* pBuf, size_t nbytes) {
+    const uint8_t* pBytes = pBuf;
+    while (nbytes > 0) {
+        ssize_t written = write(fd, pBytes, nbytes);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            err(EXIT_FAILURE, "cluster write");
+        }
+        pBytes += written;
+        nbytes -= written;
+    }
+}
+
+static void cluster_read(int fd, void* pBuf, size_t nbytes) {
+    uint8_t* pBytes = pBuf;
+    while (nbytes > 0) {
+        ssize_t bytes_read = read(fd, pBytes, nbytes);
+        if (bytes_read == -1) {
+            if (errno == EINTR) continue;
+            err(EXIT_FAILURE, "cluster read");
+        }
+        if (bytes_read == 0) {
+            errx(EXIT_FAILURE, "cluster connection closed");
+        }
+        pBytes += bytes_read;
+        nbytes -= bytes_read;
+    }
+}
+
+static void cluster_send(int fd, CLUSTER_MESSAGE type, const void* pPayload, size_t nbytes) {
+    uint8_t buffer[sizeof(uint32_t) + sizeof(cluster_stats)];
+    assert(nbytes <= sizeof(buffer) - sizeof(uint32_t));
+
+    uint32_t message_type = type;
+    memcpy(buffer, &message_type, sizeof(message_type));
+    if (nbytes > 0) {
+        memcpy(buffer + sizeof(message_type), pPayload, nbytes);
+    }
+    cluster_write(fd, buffer, sizeof(message_type) + nbytes);
+}
+
+static void cluster_expect(int fd, CLUSTER_MESSAGE type, void* pPayload, size_t nbytes) {
+    uint32_t message_type;
+    cluster_read(fd, &message_type, sizeof(message_type));
+    if (message_type != type) {
+        errx(EXIT_FAILURE, "expected cluster message %u, got %u", type, message_type);
+    }
+    if (nbytes > 0) {
+        cluster_read(fd, pPayload, nbytes);
+    }
+}
+
+static pid_t cluster_spawn(const char* socket_path, const cluster_config* pConfig) {
+    char worker_arg[sizeof(((struct sockaddr_un*)0)->sun_path) + 16];
+    char quantum_arg[16];
+    char costs_arg[64];
+    char protocol_arg[32];
+    snprintf(worker_arg, sizeof(worker_arg), "--worker=%s", socket_path);
+    snprintf(quantum_arg, sizeof(quantum_arg), "%u", pConfig->quantum);
+    snprintf(costs_arg, sizeof(costs_arg), "%u,%u,%u,%u",
+        pConfig->costs.spawn, pConfig->costs.resume, pConfig->costs.suspend, pConfig->costs.terminate);
+    snprintf(protocol_arg, sizeof(protocol_arg), "--protocol=%u", pConfig->protocol);
+
+    // Workers are this executable, whatever it was started as
+    pid_t pid = fork();
+    if (pid == -1) {
+        err(EXIT_FAILURE, "fork");
+    }
+    if (pid == 0) {
+        execl("/proc/self/exe", "allocate", worker_arg,
+            "-s", pConfig->scheduler_name,
+            "-m", pConfig->strategy == INFINITE ? "infinite" : "best-fit",
+            "-q", quantum_arg,
+            "-c", costs_arg,
+            protocol_arg,
+            NULL);
+        perror("execl");
+        _exit(EXIT_FAILURE);
+    }
+    return pid;
+}
+
+static uint32_t* cluster_components(const program* pPrograms, uint32_t count) {
+    uint32_t* pFirst = malloc(sizeof(uint32_t)*(count > 0 ? count : 1));
+    for (uint32_t i=0; i<count; i++) {
+        pFirst[i] = i;
+    }
+
+    // Joined components keep the lower first program, so the first program 
+    // of a component is always the first of it to be sent
+    for (uint32_t i=0; i<count; i++) {
+        if (pPrograms[i].pDependsOn == NULL)
+            continue;
+
+        char* depends_on = strdup(pPrograms[i].pDependsOn);
+        for (char* name = strtok(depends_on, ","); name != NULL; name = strtok(NULL, ",")) {
+            uint32_t predecessor = i;
+            while (predecessor > 0 && strcmp(pPrograms[predecessor - 1].name, name) != 0) {
+                predecessor--;
+            }
+            if (predecessor == 0) {
+                errx(EXIT_FAILURE, "%s depends on %s, which was not added before it",
+                    pPrograms[i].name, name);
+            }
+            uint32_t first = cluster_component_find(pFirst, i);
+            uint32_t other = cluster_component_find(pFirst, predecessor - 1);
+            if (first < other) {
+                pFirst[other] = first;
+            } else {
+                pFirst[first] = other;
+            }
+        }
+        FREE(depends_on);
+    }
+
+    for (uint32_t i=0; i<count; i++) {
+        pFirst[i] = cluster_component_find(pFirst, i);
+    }
+    return pFirst;
+}
+
+static uint32_t cluster_component_find(uint32_t* pFirst, uint32_t index) {
+    while (pFirst[index] != index) {
+        pFirst[index] = pFirst[pFirst[index]];
+        index = pFirst[index];
+    }
+    return index;
+}
+
+static uint32_t cluster_choose(cluster_node* pNodes, const cluster_config* pConfig,
+    const program* pProgram, const uint32_t* pNodeOf, uint32_t first, uint32_t index, uint32_t* pRoundRobin) {
+
+    // Programs follow the first program of their component, which was sent earlier
+    if (first != index) {
+        return pNodeOf[first];
+    }
+
+    if (pConfig->policy == BALANCE_ROUND_ROBIN) {
+        uint32_t chosen = *pRoundRobin;
+        *pRoundRobin = (*pRoundRobin + 1) % pConfig->node_count;
+        return chosen;
+    }
+
+    // Load is the number of unfinished programs, and ties go to the lowest node
+    uint32_t least_loaded = 0;
+    uint32_t least_load = UINT32_MAX;
+    uint32_t fitting = pConfig->node_count;
+    uint32_t fitting_load = UINT32_MAX;
+    for (uint32_t i=0; i<pConfig->node_count; i++) {
+        uint32_t load = pNodes[i].dispatched_count - pNodes[i].status.finished_count;
+        if (load < least_load) {
+            least_loaded = i;
+            least_load = load;
+        }
+
+        // A node fits the program if nothing waits for memory and enough is free
+        bool fits = pNodes[i].status.input_depth == 0 &&
+            pNodes[i].status.memory_in_use + pNodes[i].reserved_memory + pProgram->memory_required <= BUFFER_SIZE;
+        if (fits && load < fitting_load) {
+            fitting = i;
+            fitting_load = load;
+        }
+    }
+
+    if (pConfig->policy == BALANCE_MEMORY_AWARE && fitting != pConfig->node_count) {
+        return fitting;
+    }
+    return least_loaded;
+}
+
+static void cluster_dispatch(cluster_node* pNode, const program* pProgram) {
+    cluster_arrival arrival = {
+        .time_arrived = pProgram->time_arrived,
+        .service_time = pProgram->service_time,
+        .memory_required = pProgram->memory_required,
+        .burst_count = pProgram->pBursts != NULL ? pProgram->burst_count : 0,
+        .depends_length = pProgram->pDependsOn != NULL ? strlen(pProgram->pDependsOn) : 0,
+    };
+    memcpy(arrival.name, pProgram->name, sizeof(arrival.name));
+
+    // The whole message goes in one write
+    size_t burst_bytes = sizeof(uint32_t)*arrival.burst_count;
+    size_t nbytes = sizeof(uint32_t) + sizeof(arrival) + burst_bytes + arrival.depends_length;
+    uint8_t* pBuffer = malloc(nbytes);
+    uint32_t message_type = MESSAGE_ARRIVE;
+    memcpy(pBuffer, &message_type, sizeof(message_type));
+    memcpy(pBuffer + sizeof(message_type), &arrival, sizeof(arrival));
+    if (burst_bytes > 0) {
+        memcpy(pBuffer + sizeof(message_type) + sizeof(arrival), pProgram->pBursts, burst_bytes);
+    }
+    if (arrival.depends_length > 0) {
+        memcpy(pBuffer + sizeof(message_type) + sizeof(arrival) + burst_bytes,
+            pProgram->pDependsOn, arrival.depends_length);
+    }
+    cluster_write(pNode->fd, pBuffer, nbytes);
+    FREE(pBuffer);
+
+    cluster_expect(pNode->fd, MESSAGE_ACK, NULL, 0);
+    pNode->dispatched_count++;
+    pNode->reserved_memory += pProgram->memory_required;
+    pNode->status.idle = FALSE;
+    pNode->stepped = TRUE;
+}
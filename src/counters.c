@@ -0,0 +1,36 @@
+#include <counters.h>
+#include <histogram.h>
+
+THREAD_LOCAL uint64_t counter_ticks[COUNTER_COUNT] = {};
+
+static bool enabled = FALSE;
+static THREAD_LOCAL histogram counter_histograms[COUNTER_COUNT] = {};
+static const char* counter_names[COUNTER_COUNT] = {
+    "shortest_job_first nodes visited",
+    "allocator_find_best_fit blocks inspected",
+    "check_pending programs retried",
+    "should_terminate nodes walked",
+    "allocater_free_memory nodes walked",
+};
+
+void counters_enable() {
+    enabled = TRUE;
+}
+
+void counters_tick() {
+    if (enabled) {
+        for (uint32_t i=0; i<COUNTER_COUNT; i++) {
+            histogram_record(&counter_histograms[i], counter_ticks[i]);
+        }
+    }
+    memset(counter_ticks, 0, sizeof(counter_ticks));
+}
+
+void counters_print(FILE* fp) {
+    if (!enabled) return;
+
+    fprintf(fp, "Decision cost per tick\n");
+    for (uint32_t i=0; i<COUNTER_COUNT; i++) {
+        histogram_print(fp, counter_names[i], &counter_histograms[i]);
+    }
+}
@@ -0,0 +1,99 @@
+#include <histogram.h>
+#include <inttypes.h>
+
+/**
+ * @param value any value
+ * @return
+ * Index of the bucket that holds the value
+*/
+static uint32_t bucket_index(uint64_t value);
+
+/**
+ * @param index index of a bucket
+ * @return
+ * Largest value held by the bucket
+*/
+static uint64_t bucket_high(uint32_t index);
+
+void histogram_record(histogram* pHistogram, uint64_t value) {
+    assert(pHistogram != NULL);
+
+    pHistogram->counts[bucket_index(value)]++;
+    pHistogram->total++;
+    pHistogram->sum += value;
+    if (value > pHistogram->max) {
+        pHistogram->max = value;
+    }
+}
+
+uint64_t histogram_percentile(histogram* pHistogram, double percentile) {
+    assert(pHistogram != NULL);
+
+    if (pHistogram->total == 0) 
+        return 0;
+
+    // Find the first bucket where the cumulative count reaches the percentile
+    uint64_t target = (uint64_t)ceil(percentile/100.0*pHistogram->total);
+    if (target == 0) {
+        target = 1;
+    }
+    uint64_t count = 0;
+    for (uint32_t i=0; i<HISTOGRAM_BUCKETS; i++) {
+        count += pHistogram->counts[i];
+        if (count >= target) {
+            uint64_t high = bucket_high(i);
+            return high < pHistogram->max ? high : pHistogram->max;
+        }
+    }
+    return pHistogram->max;
+}
+
+void histogram_print(FILE* fp, const char* name, histogram* pHistogram) {
+    assert(fp != NULL);
+    assert(pHistogram != NULL);
+
+    double mean = pHistogram->total > 0 ? 
+        (double)pHistogram->sum / pHistogram->total : 0;
+    fprintf(fp, "%s: samples=%" PRIu64 " mean=%.2f max=%" PRIu64 "\n", 
+        name, pHistogram->total, mean, pHistogram->max);
+
+    // Sum buckets into power of two ranges, where range 0 holds zeroes and
+    // range i holds values in [2^(i-1), 2^i - 1]
+    uint64_t ranges[65] = {};
+    for (uint32_t i=0; i<HISTOGRAM_BUCKETS; i++) {
+        if (pHistogram->counts[i] == 0) continue;
+        uint64_t high = bucket_high(i);
+        ranges[high == 0 ? 0 : 64 - __builtin_clzll(high)] += pHistogram->counts[i];
+    }
+
+    for (uint32_t i=0; i<65; i++) {
+        if (ranges[i] == 0) continue;
+        uint64_t low = i == 0 ? 0 : 1ull << (i - 1);
+        uint64_t high = i == 0 ? 0 : (i == 64 ? UINT64_MAX : (1ull << i) - 1);
+        fprintf(fp, "  [%" PRIu64 ", %" PRIu64 "] %" PRIu64 "\n", low, high, ranges[i]);
+    }
+}
+
+static uint32_t bucket_index(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) 
+        return value;
+
+    // Shift the value so its top HISTOGRAM_PRECISION bits remain, which 
+    // leaves a sub bucket in [HISTOGRAM_SUB_BUCKETS/2, HISTOGRAM_SUB_BUCKETS)
+    uint32_t shift = 64 - __builtin_clzll(value) - HISTOGRAM_PRECISION;
+    uint32_t sub_bucket = value >> shift;
+    return HISTOGRAM_SUB_BUCKETS + (shift - 1)*(HISTOGRAM_SUB_BUCKETS/2) + 
+        (sub_bucket - HISTOGRAM_SUB_BUCKETS/2);
+}
+
+static uint64_t bucket_high(uint32_t index) {
+    if (index < HISTOGRAM_SUB_BUCKETS) 
+        return index;
+
+    uint32_t offset = index - HISTOGRAM_SUB_BUCKETS;
+    uint32_t shift = offset/(HISTOGRAM_SUB_BUCKETS/2) + 1;
+    uint64_t sub_bucket = offset%(HISTOGRAM_SUB_BUCKETS/2) + HISTOGRAM_SUB_BUCKETS/2;
+
+    // The top bucket wraps around to UINT64_MAX
+    return ((sub_bucket + 1) << shift) - 1;
+}
@@ -0,0 +1,365 @@
+#include <logger.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define LOG_LINE_SIZE 512
+#define LOG_DIGITS_SIZE 24 // Digits of a 64 bit integer in any base from 8 up
+#define LOG_WRITING (1ull << 63) // Set in a sequence while its record is written
+
+typedef struct log_record {
+    atomic_uint_fast64_t sequence; // Index of the record plus one, with LOG_WRITING while written
+    uint64_t timestamp_ns;
+    const char* format;
+    uint64_t args[LOG_MAX_ARGS];    // Offsets into strings for %s arguments
+    uint8_t arg_count;
+    uint8_t level;
+    char strings[LOG_STRING_SIZE];  // Copies of the %s arguments
+} log_record;
+
+#ifdef DEBUG
+LOG_LEVEL log_level = LOG_DEBUG;
+#else
+LOG_LEVEL log_level = LOG_INFO;
+#endif
+
+static log_record ring[LOG_RING_SIZE] = {};
+static atomic_uint_fast64_t ring_head = 0;
+
+static const char* level_names[LOG_LEVEL_COUNT] = {
+    "off",
+    "error",
+    "warn",
+    "info",
+    "debug",
+};
+
+static const int crash_signals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+
+/**
+ * @brief
+ * Finds the next conversion of a format string.
+ * @param format pointer into the format string
+ * @return
+ * Pointer to the % that starts the conversion, or NULL if there are no more
+ * conversions. %% is not a conversion.
+*/
+static const char* logger_next_conversion(const char* format);
+
+/**
+ * @brief
+ * Formats a record, converting each argument to the type its conversion
+ * expects. Only uses async-signal-safe code.
+ * @param pRecord record to format
+ * @param line buffer to format into
+ * @param line_size size of buffer
+ * @return
+ * Number of characters written, not including the null-terminating character
+*/
+static size_t logger_format(log_record* pRecord, char* line, size_t line_size);
+
+/**
+ * @brief
+ * Appends text to a line, padded with spaces or zeros to a width.
+ * @param line buffer to append to
+ * @param length number of characters already in the line
+ * @param line_size size of buffer
+ * @param text text to append, which need not be null-terminated
+ * @param text_length number of characters of text
+ * @param width smallest number of characters appended
+ * @param left whether the text is padded on the right instead of the left
+ * @param pad character padded with
+ * @return
+ * Length of the line, which is truncated to fit the buffer
+*/
+static size_t logger_append(char* line, size_t length, size_t line_size, const char* text, 
+    size_t text_length, uint32_t width, bool left, char pad);
+
+/**
+ * @brief
+ * Appends an integer to a line, padded to a width.
+ * @param line buffer to append to
+ * @param length number of characters already in the line
+ * @param line_size size of buffer
+ * @param value value of the integer
+ * @param negative whether the integer is -value
+ * @param base 8, 10 or 16
+ * @param upper whether hexadecimal digits are upper case
+ * @param width smallest number of characters appended
+ * @param left whether the integer is padded on the right instead of the left
+ * @param pad character padded with
+ * @return
+ * Length of the line, which is truncated to fit the buffer
+*/
+static size_t logger_append_integer(char* line, size_t length, size_t line_size, uint64_t value, 
+    bool negative, uint32_t base, bool upper, uint32_t width, bool left, char pad);
+
+/**
+ * @brief
+ * Dumps the ring buffer. Crash signals are then raised again with the default
+ * handler, which was restored by SA_RESETHAND.
+*/
+static void logger_signal_handler(int signal);
+
+void logger_initialise(LOG_LEVEL level) {
+    assert(level < LOG_LEVEL_COUNT);
+    log_level = level;
+
+    struct sigaction action = {};
+    action.sa_handler = logger_signal_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGUSR1, &action, NULL) == -1) {
+        err(EXIT_FAILURE, "sigaction");
+    }
+
+    action.sa_flags = SA_RESETHAND;
+    for (uint32_t i = 0; i < sizeof(crash_signals)/sizeof(int); i++) {
+        if (sigaction(crash_signals[i], &action, NULL) == -1) {
+            err(EXIT_FAILURE, "sigaction");
+        }
+    }
+}
+
+bool logger_parse_level(const char* name, LOG_LEVEL* pLevel) {
+    assert(name != NULL);
+    assert(pLevel != NULL);
+
+    for (uint32_t level = 0; level < LOG_LEVEL_COUNT; level++) {
+        if (strcmp(name, level_names[level]) == 0) {
+            *pLevel = level;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void logger_record(LOG_LEVEL level, const char* format, uint64_t* pArgs, uint32_t arg_count) {
+    assert(arg_count <= LOG_MAX_ARGS);
+
+    // Claim an index, then take its slot by swapping LOG_WRITING into the
+    // sequence. Writers a lap apart map to the same slot, so a writer that
+    // finds the slot still being written, or already taken by a later lap,
+    // drops its record rather than mix its fields with another one.
+    uint64_t index = atomic_fetch_add_explicit(&ring_head, 1, memory_order_relaxed);
+    log_record* pRecord = &ring[index & (LOG_RING_SIZE - 1)];
+    uint64_t sequence = atomic_load_explicit(&pRecord->sequence, memory_order_relaxed);
+    do {
+        if ((sequence & LOG_WRITING) || sequence > index) 
+            return;
+    } while (!atomic_compare_exchange_weak_explicit(&pRecord->sequence, &sequence, 
+        (index + 1) | LOG_WRITING, memory_order_acquire, memory_order_relaxed));
+    atomic_thread_fence(memory_order_release);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pRecord->timestamp_ns = (uint64_t)now.tv_sec*1000000000ull + now.tv_nsec;
+    pRecord->format = format;
+    pRecord->level = level;
+    pRecord->arg_count = arg_count;
+
+    // Strings are copied, truncated if needed, since the caller's copy may
+    // not outlive the record. The last byte is always a null terminator.
+    const char* conversion = logger_next_conversion(format);
+    size_t strings_used = 0;
+    for (uint32_t i = 0; i < arg_count; i++) {
+        pRecord->args[i] = pArgs[i];
+        if (conversion == NULL)
+            continue;
+        conversion += 1 + strcspn(conversion + 1, "diouxXcsp");
+        if (*conversion == 's') {
+            // Once the strings are full, later ones point at the last byte
+            const char* string = (const char*)(uintptr_t)pArgs[i];
+            size_t offset = strings_used < LOG_STRING_SIZE ? strings_used : LOG_STRING_SIZE - 1;
+            size_t length = string != NULL ? strnlen(string, LOG_STRING_SIZE - 1 - offset) : 0;
+            memcpy(pRecord->strings + offset, string != NULL ? string : "", length);
+            pRecord->strings[offset + length] = '\0';
+            pRecord->args[i] = offset;
+            strings_used = offset + length + 1;
+        }
+        conversion = *conversion != '\0' ? logger_next_conversion(conversion + 1) : NULL;
+    }
+
+    // Publishing clears LOG_WRITING, so the dump and later laps see the record
+    atomic_store_explicit(&pRecord->sequence, index + 1, memory_order_release);
+
+#ifdef DEBUG
+    char line[LOG_LINE_SIZE];
+    logger_format(pRecord, line, sizeof(line));
+    printf("%s", line);
+#endif
+}
+
+void logger_dump() {
+    char line[LOG_LINE_SIZE];
+    uint64_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+    uint64_t first = head > LOG_RING_SIZE ? head - LOG_RING_SIZE : 0;
+
+    #define APPEND_TEXT(text) \
+        length = logger_append(line, length, sizeof(line), text, strlen(text), 0, FALSE, ' ')
+
+    size_t length = 0;
+    APPEND_TEXT("---- last ");
+    length = logger_append_integer(line, length, sizeof(line), head - first, FALSE, 10, FALSE, 0, FALSE, ' ');
+    APPEND_TEXT(" of ");
+    length = logger_append_integer(line, length, sizeof(line), head, FALSE, 10, FALSE, 0, FALSE, ' ');
+    APPEND_TEXT(" log records ----\n");
+    write(STDERR_FILENO, line, length);
+
+    for (uint64_t index = first; index < head; index++) {
+        log_record* pRecord = &ring[index & (LOG_RING_SIZE - 1)];
+        if (atomic_load_explicit(&pRecord->sequence, memory_order_acquire) != index + 1) 
+            continue;
+
+        // Prefix with the level and the time in seconds
+        const char* level_name = level_names[pRecord->level];
+        length = 0;
+        APPEND_TEXT("[");
+        length = logger_append(line, length, sizeof(line), level_name, strlen(level_name), 5, FALSE, ' ');
+        APPEND_TEXT(" ");
+        length = logger_append_integer(line, length, sizeof(line), 
+            pRecord->timestamp_ns / 1000000000ull, FALSE, 10, FALSE, 0, FALSE, ' ');
+        APPEND_TEXT(".");
+        length = logger_append_integer(line, length, sizeof(line), 
+            pRecord->timestamp_ns % 1000000000ull / 1000, FALSE, 10, FALSE, 6, FALSE, '0');
+        APPEND_TEXT("] ");
+        length += logger_format(pRecord, line + length, sizeof(line) - length);
+
+        // A writer may have taken the slot while it was formatted
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&pRecord->sequence, memory_order_relaxed) != index + 1)
+            continue;
+        write(STDERR_FILENO, line, length);
+    }
+
+    #undef APPEND_TEXT
+}
+
+static const char* logger_next_conversion(const char* format) {
+    for (const char* c = format; *c != '\0'; c++) {
+        if (*c != '%')
+            continue;
+        if (c[1] != '%')
+            return c;
+        c++;
+    }
+    return NULL;
+}
+
+static size_t logger_format(log_record* pRecord, char* line, size_t line_size) {
+    size_t length = 0;
+    uint32_t arg = 0;
+    const char* c = pRecord->format;
+
+    while (*c != '\0' && length + 1 < line_size) {
+        if (*c != '%' || c[1] == '%') {
+            line[length++] = *c;
+            c += *c == '%' ? 2 : 1;
+            continue;
+        }
+
+        // Flags, width and length modifiers, of which only - and 0 are used
+        bool left = FALSE;
+        char pad = ' ';
+        uint32_t width = 0;
+        for (c++; *c == '-' || *c == '0'; c++) {
+            if (*c == '-') left = TRUE;
+            else pad = '0';
+        }
+        while (isdigit((unsigned char)*c)) {
+            width = width*10 + (*c++ - '0');
+        }
+        uint32_t longs = 0;
+        while (*c == 'l' || *c == 'z' || *c == 'h') {
+            if (*c != 'h') longs++;
+            c++;
+        }
+        if (*c == '\0') 
+            break;
+        char conversion = *c++;
+
+        uint64_t value = arg < pRecord->arg_count ? pRecord->args[arg++] : 0;
+        switch(conversion) 
+        {
+            case('s'): {
+                const char* string = pRecord->strings + (value < LOG_STRING_SIZE ? value : LOG_STRING_SIZE - 1);
+                length = logger_append(line, length, line_size, string, strlen(string), width, left, ' ');
+                break;
+            }
+            case('c'): {
+                char character = (char)value;
+                length = logger_append(line, length, line_size, &character, 1, width, left, ' ');
+                break;
+            }
+            case('d'):
+            case('i'): {
+                int64_t signed_value = longs > 0 ? (int64_t)value : (int32_t)value;
+                uint64_t magnitude = signed_value < 0 ? -(uint64_t)signed_value : (uint64_t)signed_value;
+                length = logger_append_integer(line, length, line_size, magnitude, 
+                    signed_value < 0, 10, FALSE, width, left, pad);
+                break;
+            }
+            case('p'):
+                length = logger_append(line, length, line_size, "0x", 2, 0, FALSE, ' ');
+                length = logger_append_integer(line, length, line_size, value, 
+                    FALSE, 16, FALSE, width > 2 ? width - 2 : 0, left, pad);
+                break;
+            default: {
+                uint32_t base = conversion == 'o' ? 8 : conversion == 'u' ? 10 : 16;
+                length = logger_append_integer(line, length, line_size, 
+                    longs > 0 ? value : (uint32_t)value, 
+                    FALSE, base, conversion == 'X', width, left, pad);
+                break;
+            }
+        }
+    }
+
+    line[length] = '\0';
+    return length;
+}
+
+static size_t logger_append(char* line, size_t length, size_t line_size, const char* text, 
+                            size_t text_length, uint32_t width, bool left, char pad) {
+    size_t padding = width > text_length ? width - text_length : 0;
+    for (size_t i = 0; !left && i < padding && length + 1 < line_size; i++) {
+        line[length++] = pad;
+    }
+    for (size_t i = 0; i < text_length && length + 1 < line_size; i++) {
+        line[length++] = text[i];
+    }
+    for (size_t i = 0; left && i < padding && length + 1 < line_size; i++) {
+        line[length++] = ' ';
+    }
+    return length;
+}
+
+static size_t logger_append_integer(char* line, size_t length, size_t line_size, uint64_t value, 
+                                    bool negative, uint32_t base, bool upper, uint32_t width, bool left, char pad) {
+    const char* digit_names = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+
+    // Digits are produced from the least significant, so they fill from the end
+    char digits[LOG_DIGITS_SIZE];
+    size_t start = sizeof(digits);
+    do {
+        digits[--start] = digit_names[value % base];
+        value /= base;
+    } while (value > 0);
+
+    // A sign goes before zero padding but after space padding
+    if (negative) {
+        if (pad == '0' && !left) {
+            length = logger_append(line, length, line_size, "-", 1, 0, FALSE, ' ');
+            width = width > 0 ? width - 1 : 0;
+        } else {
+            digits[--start] = '-';
+        }
+    }
+    return logger_append(line, length, line_size, digits + start, 
+        sizeof(digits) - start, width, left, left ? ' ' : pad);
+}
+
+static void logger_signal_handler(int signal) {
+    logger_dump();
+    if (signal != SIGUSR1) {
+        raise(signal);
+    }
+}
@@ -2,23 +2,93 @@
 
 #include "defines.h"
 #include "process_manager.h"
+#include "counters.h"
+#include "accounting.h"
+#include "report.h"
+#include "progress.h"
+#include "metrics.h"
+#include "logger.h"
+#include "timeseries.h"
+#include "batch.h"
+#include "pipeline.h"
+#include "montecarlo.h"
+#include "autotune.h"
+#include "cluster.h"
+#include "cache.h"
 
 int main(int argc, char* argv[]) {
     uint32_t quantum = 0;
     char filename[256] = {};
-    SCHEDULER_TYPE scheduler_type = 0;
+    char scheduler_name[256] = "SJF";
     MEMORY_STRATEGY memory_strategy = 0;
+    cost_model costs = {};
+    affinity cpu_affinity = { .manager_cpu = -1, .placement = PLACE_ANY };
+    uint32_t protocol = PROTOCOL_SIGNALS;
+    bool speculate = FALSE;
+    uint32_t report_flags = 0;
+    char* report_path = NULL;
+    double progress_interval = 0;
+    char* metrics_address = NULL;
+    LOG_LEVEL level = log_level;
+    char* timeseries_path = NULL;
+    uint32_t sample_interval = 0;
+    char* batch_path = NULL;
+    uint32_t batch_threads = 0;
+    bool pipelined = FALSE;
+    montecarlo_config montecarlo = { .seed = 1 };
+    bool autotune = FALSE;
+    autotune_config tuning = { .objective = OBJECTIVE_TURNAROUND };
+    cluster_config cluster = { .policy = BALANCE_ROUND_ROBIN };
+    char* worker_socket = NULL;
+    char* cache_directory = NULL;
+    uint64_t cache_megabytes = CACHE_DEFAULT_MEGABYTES;
+    bool counting = FALSE;
+    bool accounting = FALSE;
     process_manager manager = NULL;
+    static report run_report = {}; // Too large for the stack
+
+    static struct option long_options[] = {
+        {"costs", required_argument, 0, 'c'},
+        {"counters", no_argument, 0, 'C'},
+        {"percentiles", no_argument, 0, 'P'},
+        {"bounds", no_argument, 0, 'B'},
+        {"accounting", required_argument, 0, 'A'},
+        {"report", required_argument, 0, 'R'},
+        {"progress", optional_argument, 0, 'H'},
+        {"metrics", required_argument, 0, 'M'},
+        {"log-level", required_argument, 0, 'L'},
+        {"timeseries", required_argument, 0, 'T'},
+        {"sample-interval", required_argument, 0, 'I'},
+        {"pin-manager", required_argument, 0, 'X'},
+        {"child-placement", required_argument, 0, 'Y'},
+        {"protocol", required_argument, 0, 'V'},
+        {"speculate", no_argument, 0, 'S'},
+        {"batch", required_argument, 0, 'N'},
+        {"jobs", required_argument, 0, 'J'},
+        {"pipeline", no_argument, 0, 'W'},
+        {"montecarlo", required_argument, 0, 'K'},
+        {"jitter", required_argument, 0, 'E'},
+        {"service-noise", required_argument, 0, 'F'},
+        {"memory-noise", required_argument, 0, 'G'},
+        {"seed", required_argument, 0, 'Z'},
+        {"autotune", optional_argument, 0, 'U'},
+        {"cluster", required_argument, 0, 'D'},
+        {"balance", required_argument, 0, 'O'},
+        {"worker", required_argument, 0, 'Q'},
+        {"cache", optional_argument, 0, 'k'},
+        {"cache-size", required_argument, 0, 'z'},
+        {0, 0, 0, 0}
+    };
     
     // Process option flags
     int32_t flag;
-    while( (flag = getopt(argc, argv, "f:s:m:q:")) != -1) {
+    while( (flag = getopt_long(argc, argv, "f:s:m:q:c:CPBA:R:", long_options, NULL)) != -1) {
         switch(flag) {
             case('f'):
                 strcpy(filename, optarg);
                 break;
             case('s'):
-                scheduler_type = strcmp("SJF", optarg) == 0 ? SJF : RR;
+                snprintf(scheduler_name, sizeof(scheduler_name), "%s", optarg);
                 break;
             case('m'):
                 memory_strategy = strcmp("infinite", optarg) == 0 ? INFINITE : BEST_FIT;
@@ -27,6 +97,143 @@ int main(int argc, char* argv[]) {
                 char* tmp_string;
                 quantum = strtol(optarg, &tmp_string, 10);
                 break;
+            case('c'):
+                // Costs are given as spawn,resume,suspend,terminate
+                if (sscanf(optarg, "%u,%u,%u,%u", 
+                        &costs.spawn, 
+                        &costs.resume, 
+                        &costs.suspend, 
+                        &costs.terminate) != 4) {
+                    fprintf(stderr, "invalid costs: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case('C'):
+                counters_enable();
+                counting = TRUE;
+                break;
+            case('P'):
+                report_flags |= REPORT_PERCENTILES;
+                break;
+            case('B'):
+                report_flags |= REPORT_BOUNDS;
+                break;
+            case('A'):
+                accounting_open(optarg);
+                accounting = TRUE;
+                break;
+            case('R'):
+                report_path = optarg;
+                break;
+            case('H'):
+                progress_interval = optarg != NULL ? strtod(optarg, NULL) : 1.0;
+                if (progress_interval <= 0) {
+                    fprintf(stderr, "invalid progress interval: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case('M'):
+                metrics_address = optarg;
+                break;
+            case('L'):
+                if (!logger_parse_level(optarg, &level)) {
+                    fprintf(stderr, "invalid log level: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case('T'):
+                timeseries_path = optarg;
+                break;
+            case('I'):
+                sample_interval = strtoul(optarg, NULL, 10);
+                break;
+            case('X'):
+                cpu_affinity.manager_cpu = strtol(optarg, NULL, 10);
+                report_flags |= REPORT_ROUND_TRIP;
+                break;
+            case('Y'): {
+                static const char* placement_names[] = CHILD_PLACEMENT_NAMES;
+                uint32_t placement = 0;
+                while (placement <= PLACE_SPREAD && strcmp(optarg, placement_names[placement]) != 0) {
+                    placement++;
+                }
+                if (placement > PLACE_SPREAD) {
+                    fprintf(stderr, "invalid child placement: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                cpu_affinity.placement = placement;
+                report_flags |= REPORT_ROUND_TRIP;
+                break;
+            }
+            case('V'):
+                protocol = strtoul(optarg, NULL, 10);
+                if (protocol != PROTOCOL_EMULATED && 
+                    protocol != PROTOCOL_SIGNALS && 
+                    protocol != PROTOCOL_MESSAGES) {
+                    fprintf(stderr, "invalid protocol: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case('S'):
+                speculate = TRUE;
+                break;
+            case('N'):
+                batch_path = optarg;
+                break;
+            case('J'):
+                batch_threads = strtoul(optarg, NULL, 10);
+                break;
+            case('W'):
+                pipelined = TRUE;
+                break;
+            case('K'):
+                montecarlo.variant_count = strtoul(optarg, NULL, 10);
+                if (montecarlo.variant_count < 2) {
+                    fprintf(stderr, "invalid number of variants: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case('E'):
+                montecarlo.arrival_jitter = strtoul(optarg, NULL, 10);
+                break;
+            case('F'):
+                montecarlo.service_noise = strtod(optarg, NULL);
+                break;
+            case('G'):
+                montecarlo.memory_noise = strtod(optarg, NULL);
+                break;
+            case('Z'):
+                montecarlo.seed = strtoull(optarg, NULL, 10);
+                break;
+            case('U'):
+                autotune = TRUE;
+                if (optarg != NULL && !autotune_parse_objective(optarg, &tuning.objective)) {
+                    fprintf(stderr, "invalid objective: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case('D'):
+                cluster.node_count = strtoul(optarg, NULL, 10);
+                if (cluster.node_count == 0) {
+                    fprintf(stderr, "invalid number of nodes: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case('O'):
+                if (!cluster_parse_policy(optarg, &cluster.policy)) {
+                    fprintf(stderr, "invalid balancing policy: %s\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case('Q'):
+                worker_socket = optarg;
+                break;
+            case('k'):
+                cache_directory = optarg != NULL ? optarg : CACHE_DEFAULT_DIRECTORY;
+                break;
+            case('z'):
+                cache_megabytes = strtoull(optarg, NULL, 10);
+                break;
             case('?'):
                 fprintf(stderr, "unknown option: %c\n", optopt);
                 break;
@@ -41,43 +248,185 @@ int main(int argc, char* argv[]) {
         printf("extra arguments: %s\n", argv[optind]); 
     }
 
+    logger_initialise(level);
+
+    // Batches run each line of a manifest instead of a single file
+    if (batch_path != NULL) {
+        return batch_run(batch_path, batch_threads, protocol) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Clusters spread the file over nodes, each of which is a worker
+    cluster.scheduler_name = scheduler_name;
+    cluster.strategy = memory_strategy;
+    cluster.quantum = quantum;
+    cluster.costs = costs;
+    cluster.protocol = protocol;
+    if (worker_socket != NULL) {
+        cluster_work(worker_socket, &cluster);
+        return EXIT_SUCCESS;
+    }
+    if (cluster.node_count > 0) {
+        cluster_coordinate(filename, &cluster);
+        return EXIT_SUCCESS;
+    }
+
+    // Monte-Carlo evaluation simulates variants of the file instead of the file
+    if (montecarlo.variant_count > 0) {
+        montecarlo.quantum = quantum;
+        montecarlo.costs = costs;
+        montecarlo.thread_count = batch_threads;
+        montecarlo_run(filename, &montecarlo);
+        return EXIT_SUCCESS;
+    }
+
+    // Autotuning searches for the flags to run the file with instead of running it
+    if (autotune) {
+        tuning.costs = costs;
+        tuning.thread_count = batch_threads;
+        autotune_run(filename, &tuning);
+        return EXIT_SUCCESS;
+    }
+
+    // Runs whose only results are their output and report can be replayed.
+    // Runs that also measure themselves or write other files always simulate.
+    char cache_key_hex[SHA_HASH_SIZE + 1] = {};
+    bool cached = cache_directory != NULL && !pipelined && !counting && !accounting &&
+        progress_interval == 0 && metrics_address == NULL && timeseries_path == NULL &&
+        (report_flags & REPORT_ROUND_TRIP) == 0;
+    if (cached) {
+        char configuration[1024];
+        snprintf(configuration, sizeof(configuration),
+            "scheduler=%s memory=%s quantum=%u costs=%u,%u,%u,%u flags=%u speculate=%u report=%u file=%s",
+            scheduler_name, memory_strategy == INFINITE ? "infinite" : "best-fit", quantum,
+            costs.spawn, costs.resume, costs.suspend, costs.terminate,
+            report_flags, speculate, report_path != NULL, report_path != NULL ? filename : "");
+        cache_open(cache_directory, cache_megabytes << 20);
+
+        // Like scheduler_find(), a name with a slash is a plugin
+        const char* plugin_path = strchr(scheduler_name, '/') != NULL ? scheduler_name : NULL;
+        cached = cache_key(filename, plugin_path, configuration, cache_key_hex);
+    }
+    if (cached && cache_replay(cache_key_hex, stdout, report_path)) {
+        fprintf(stderr, "Replayed cache entry %s\n", cache_key_hex);
+        return 0;
+    }
+
     // Initialise Process Manager
-    process_manager_initialise(&manager, scheduler_type, memory_strategy);
+    process_manager_initialise(&manager, scheduler_name, memory_strategy);
+    set_cost_model(manager, &costs);
+    set_report_flags(manager, report_flags);
+    set_affinity(manager, &cpu_affinity);
+    set_protocol(manager, protocol);
+    set_speculation(manager, speculate);
+    if (cached) {
+        set_output(manager, cache_capture(stdout));
+    }
+
+    // Pipelined runs parse the file on another thread during the execution loop
+    double phase_start = wall_time();
+    if (pipelined && !pipeline_start(manager, filename)) {
+        printf("Could not open file %s\n", filename);
+        return 0;
+    }
 
     // Extract data about each program from file
     // and add them to the process manager
-    FILE* fp = fopen(filename, "r");
-    if (fp == NULL) {
+    run_report.fingerprint = FINGERPRINT_SEED;
+    FILE* fp = pipelined ? NULL : fopen(filename, "r");
+    if (fp == NULL && !pipelined) {
         printf("Could not open file %s\n", filename);
         return 0;
     }
-    while(TRUE) {
+    char* line = NULL;
+    size_t line_size = 0;
+    uint32_t line_number = 0;
+    ssize_t line_length;
+    while(fp != NULL && (line_length = getline(&line, &line_size, fp)) != -1) {
+        run_report.fingerprint = fingerprint_update(run_report.fingerprint, line, line_length);
+        run_report.trace_bytes += line_length;
+
         program new_program = {};
-        if (fscanf(fp, "%u %s %u %hu\n", 
-                    &new_program.time_arrived, 
-                    new_program.name, 
-                    &new_program.service_time, 
-                    &new_program.memory_required) == EOF) 
-        break;
+        if (!program_parse(line, ++line_number, &new_program)) 
+            continue;
         
         program_add(manager, &new_program);
     }
-    fclose(fp);
-    fp = NULL;
+    FREE(line);
+    if (fp != NULL) {
+        fclose(fp);
+        fp = NULL;
 
-    // Print some debug message if we're debugging
-    debug_print_programs(manager);
+        // Print some debug message if we're debugging
+        debug_print_programs(manager);
+        
+        run_report.parse_seconds = wall_time() - phase_start;
+    }
     
     // Execution loop
-    while(!should_terminate(manager)) {
+    phase_start = wall_time();
+    if (progress_interval > 0) {
+        progress_start(progress_interval);
+    }
+    if (metrics_address != NULL) {
+        metrics_start(metrics_address);
+        // Scrapes before the first interval already see the parsed programs
+        metrics_publish(manager, TRUE);
+    }
+    if (timeseries_path != NULL) {
+        timeseries_enable(sample_interval);
+    }
+    while((pipelined && pipeline_admit(manager)) || !should_terminate(manager)) {
+        uint64_t phase_time = metrics_now();
         check_pending(manager);
+        phase_time = metrics_phase(PHASE_ADMIT, phase_time);
         if (!keep_process_running(manager)) {
             switch_process(manager);
         }
+        phase_time = metrics_phase(PHASE_SCHEDULE, phase_time);
+        timeseries_sample(manager);
         update(manager, quantum);
+        metrics_phase(PHASE_UPDATE, phase_time);
+        metrics_publish(manager, FALSE);
+        if (progress_due) {
+            progress_report(manager);
+        }
+    }
+    if (progress_interval > 0) {
+        progress_stop();
+    }
+    metrics_publish(manager, TRUE);
+    metrics_stop();
+    if (pipelined) {
+        pipeline_stop(&run_report);
+    }
+    run_report.simulate_seconds = wall_time() - phase_start;
+    if (timeseries_path != NULL) {
+        timeseries_write(timeseries_path, manager);
+    }
+    if (report_path != NULL) {
+        run_stats stats;
+        process_manager_get_stats(manager, &stats);
+        report_set_stats(&run_report, &stats);
     }
 
     // Destroy and free used state
+    phase_start = wall_time();
     process_manager_destroy(&manager);
+    accounting_close();
+    run_report.teardown_seconds = wall_time() - phase_start;
+
+    if (report_path != NULL) {
+        run_report.filename = filename;
+        run_report.scheduler_name = scheduler_name;
+        run_report.memory_strategy = memory_strategy;
+        run_report.quantum = quantum;
+        run_report.costs = costs;
+        run_report.affinity = cpu_affinity;
+        run_report.timings = TRUE;
+        report_write(report_path, &run_report);
+    }
+    if (cached) {
+        cache_store(cache_key_hex, report_path != NULL ? &run_report : NULL);
+    }
     return 0;
 }
@@ -0,0 +1,347 @@
+#include <metrics.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define METRICS_PAGE_SIZE 8192
+
+// How long a client may take to send its request or read the page
+#define METRICS_CLIENT_TIMEOUT_SECONDS 1
+
+typedef struct phase_histogram {
+    uint64_t buckets[METRICS_BUCKET_COUNT + 1]; // Last bucket is +Inf
+    uint64_t count;
+    uint64_t sum_ns;
+} phase_histogram;
+
+typedef struct metrics_snapshot {
+    run_gauges gauges;
+    allocator_stats allocator;
+    double events_per_second;
+    double ticks_per_second;
+    phase_histogram phases[PHASE_COUNT];
+} metrics_snapshot;
+
+static const char* phase_names[PHASE_COUNT] = {
+    "admit",
+    "schedule",
+    "update",
+};
+
+static bool enabled = FALSE;
+static int listen_fd = -1;
+static char socket_path[sizeof(((struct sockaddr_un*)0)->sun_path)] = {};
+static pthread_t server_thread;
+
+// Connection being answered, which metrics_stop() shuts down so an idle
+// client cannot keep the server thread from exiting
+static pthread_mutex_t client_lock = PTHREAD_MUTEX_INITIALIZER;
+static int client_fd = -1;
+static bool stopping = FALSE;
+
+// Only touched by the execution loop
+static phase_histogram phases[PHASE_COUNT] = {};
+static uint64_t last_publish_ns = 0;
+static run_gauges last_gauges = {};
+
+// Sequence lock, odd while the execution loop is writing the snapshot
+static atomic_uint snapshot_sequence = 0;
+static metrics_snapshot snapshot = {};
+
+/**
+ * @brief
+ * Copies the latest snapshot, retrying if the execution loop published a new
+ * one part way through the copy.
+ * @param pCopy pointer to where the snapshot will be copied
+*/
+static void snapshot_read(metrics_snapshot* pCopy);
+
+/**
+ * @brief
+ * Writes the snapshot in Prometheus text format.
+ * @param pSnapshot snapshot to write
+ * @param page buffer to write to
+ * @param page_size size of buffer
+ * @return
+ * Number of bytes written
+*/
+static size_t metrics_format(metrics_snapshot* pSnapshot, char* page, size_t page_size);
+
+/**
+ * @brief
+ * Accepts connections and answers each with the latest snapshot until the 
+ * listening socket is shut down.
+*/
+static void* metrics_serve(void* arg);
+
+static uint64_t monotonic_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec*1000000000ull + now.tv_nsec;
+}
+
+void metrics_start(const char* address) {
+    assert(address != NULL);
+    assert(!enabled);
+
+    // Digits only means a loopback port
+    bool is_port = address[0] != '\0';
+    for (const char* c = address; *c != '\0'; c++) {
+        if (!isdigit(*c)) is_port = FALSE;
+    }
+
+    if (is_port) {
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(strtoul(address, NULL, 10));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if ((listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) {
+            err(EXIT_FAILURE, "socket");
+        }
+        int reuse = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+            err(EXIT_FAILURE, "bind 127.0.0.1:%s", address);
+        }
+    } else {
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (strlen(address) >= sizeof(addr.sun_path)) {
+            errx(EXIT_FAILURE, "metrics socket path too long: %s", address);
+        }
+        strcpy(addr.sun_path, address);
+        if ((listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) == -1) {
+            err(EXIT_FAILURE, "socket");
+        }
+        // Only a socket left behind by an earlier run is replaced
+        struct stat existing;
+        if (lstat(address, &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                errx(EXIT_FAILURE, "%s exists and is not a socket", address);
+            }
+            unlink(address);
+        }
+        if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+            err(EXIT_FAILURE, "bind %s", address);
+        }
+        strcpy(socket_path, address);
+    }
+    if (listen(listen_fd, 8) == -1) {
+        err(EXIT_FAILURE, "listen");
+    }
+
+    // The server thread must not take signals meant for the execution loop
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    int error = pthread_create(&server_thread, NULL, metrics_serve, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (error != 0) {
+        errno = error;
+        err(EXIT_FAILURE, "pthread_create");
+    }
+
+    enabled = TRUE;
+    last_publish_ns = monotonic_ns();
+}
+
+uint64_t metrics_now() {
+    return enabled ? monotonic_ns() : 0;
+}
+
+uint64_t metrics_phase(METRICS_PHASE phase, uint64_t start) {
+    if (!enabled) 
+        return 0;
+
+    uint64_t end = monotonic_ns();
+    uint64_t elapsed = end - start;
+    uint32_t bucket = 0;
+    while (bucket < METRICS_BUCKET_COUNT && elapsed > (1000ull << bucket)) {
+        bucket++;
+    }
+    phases[phase].buckets[bucket]++;
+    phases[phase].count++;
+    phases[phase].sum_ns += elapsed;
+    return end;
+}
+
+void metrics_publish(process_manager manager, bool force) {
+    if (!enabled) 
+        return;
+
+    uint64_t now = monotonic_ns();
+    double elapsed = (now - last_publish_ns) / 1e9;
+    if (!force && elapsed < METRICS_PUBLISH_INTERVAL) 
+        return;
+
+    // Gather everything before taking the lock so the write is just a copy
+    metrics_snapshot next = {};
+    run_stats stats;
+    process_manager_get_gauges(manager, &next.gauges);
+    process_manager_get_stats(manager, &stats);
+    next.allocator = stats.allocator;
+    if (elapsed > 0) {
+        next.events_per_second = (next.gauges.event_count - last_gauges.event_count) / elapsed;
+        next.ticks_per_second = (next.gauges.tick_count - last_gauges.tick_count) / elapsed;
+    }
+    memcpy(next.phases, phases, sizeof(phases));
+
+    uint32_t sequence = atomic_load_explicit(&snapshot_sequence, memory_order_relaxed);
+    atomic_store_explicit(&snapshot_sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    snapshot = next;
+    atomic_store_explicit(&snapshot_sequence, sequence + 2, memory_order_release);
+
+    last_publish_ns = now;
+    last_gauges = next.gauges;
+}
+
+void metrics_stop() {
+    if (!enabled) 
+        return;
+
+    // Wakes the server thread out of accept(), or out of a client that has
+    // not sent its request yet
+    pthread_mutex_lock(&client_lock);
+    stopping = TRUE;
+    shutdown(listen_fd, SHUT_RDWR);
+    if (client_fd != -1) {
+        shutdown(client_fd, SHUT_RDWR);
+    }
+    pthread_mutex_unlock(&client_lock);
+    pthread_join(server_thread, NULL);
+    close(listen_fd);
+    listen_fd = -1;
+    stopping = FALSE;
+    if (socket_path[0] != '\0') {
+        unlink(socket_path);
+        socket_path[0] = '\0';
+    }
+    enabled = FALSE;
+}
+
+static void snapshot_read(metrics_snapshot* pCopy) {
+    uint32_t before, after;
+    do {
+        before = atomic_load_explicit(&snapshot_sequence, memory_order_acquire);
+        if (before & 1) 
+            continue;
+        *pCopy = snapshot;
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&snapshot_sequence, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+}
+
+static size_t metrics_format(metrics_snapshot* pSnapshot, char* page, size_t page_size) {
+    size_t length = 0;
+    run_gauges* pGauges = &pSnapshot->gauges;
+    allocator_stats* pAllocator = &pSnapshot->allocator;
+
+    #define APPEND(format, ...) \
+        if (length < page_size) \
+            length += snprintf(page + length, page_size - length, format, ##__VA_ARGS__)
+    #define METRIC(name, type, help, format, value) \
+        APPEND("# HELP allocate_" name " " help "\n# TYPE allocate_" name " " type "\n"); \
+        APPEND("allocate_" name " " format "\n", value)
+
+    METRIC("simulation_time", "gauge", "Current simulation time.", "%u", pGauges->time);
+    METRIC("programs", "gauge", "Programs added to the process manager.", "%u", pGauges->program_count);
+    METRIC("admitted_total", "counter", "Programs admitted to the ready list.", "%u", pGauges->admitted_count);
+    METRIC("finished_total", "counter", "Processes that have finished.", "%u", pGauges->finished_count);
+    METRIC("input_depth", "gauge", "Programs waiting in the input list.", "%u", pGauges->input_depth);
+    METRIC("ready_depth", "gauge", "Processes in the ready list.", "%u", pGauges->ready_depth);
+    METRIC("blocked_depth", "gauge", "Processes blocked on I/O.", "%u", pGauges->blocked_depth);
+    METRIC("live_children", "gauge", "Child processes spawned and not yet terminated.", "%u", pGauges->live_children);
+    METRIC("ticks_total", "counter", "Iterations of the execution loop.", "%" PRIu64, pGauges->tick_count);
+    METRIC("events_total", "counter", "Events logged.", "%" PRIu64, pGauges->event_count);
+    METRIC("ticks_per_second", "gauge", "Ticks per second since the previous snapshot.", "%.1f", pSnapshot->ticks_per_second);
+    METRIC("events_per_second", "gauge", "Events per second since the previous snapshot.", "%.1f", pSnapshot->events_per_second);
+    METRIC("memory_in_use_mb", "gauge", "Memory allocated to processes.", "%u", pAllocator->in_use);
+    METRIC("memory_free_mb", "gauge", "Memory in the free list.", "%u", pAllocator->free_memory);
+    METRIC("memory_largest_free_mb", "gauge", "Largest block in the free list.", "%u", pAllocator->largest_free);
+    METRIC("memory_free_blocks", "gauge", "Blocks in the free list.", "%u", pAllocator->free_blocks);
+    METRIC("memory_fragmentation", "gauge", "1 - largest free block / free memory.", "%.4f", pAllocator->fragmentation);
+    METRIC("allocations_total", "counter", "Successful allocations.", "%" PRIu64, pAllocator->allocations);
+    METRIC("failed_allocations_total", "counter", "Allocations that found no large enough block.", "%" PRIu64, pAllocator->failed_allocations);
+
+    APPEND("# HELP allocate_phase_seconds Latency of each phase of the execution loop.\n");
+    APPEND("# TYPE allocate_phase_seconds histogram\n");
+    for (uint32_t phase = 0; phase < PHASE_COUNT; phase++) {
+        phase_histogram* pHistogram = &pSnapshot->phases[phase];
+        uint64_t cumulative = 0;
+        for (uint32_t bucket = 0; bucket < METRICS_BUCKET_COUNT; bucket++) {
+            cumulative += pHistogram->buckets[bucket];
+            APPEND("allocate_phase_seconds_bucket{phase=\"%s\",le=\"%g\"} %" PRIu64 "\n",
+                phase_names[phase], (1000ull << bucket) / 1e9, cumulative);
+        }
+        APPEND("allocate_phase_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %" PRIu64 "\n",
+            phase_names[phase], pHistogram->count);
+        APPEND("allocate_phase_seconds_sum{phase=\"%s\"} %.9f\n",
+            phase_names[phase], pHistogram->sum_ns / 1e9);
+        APPEND("allocate_phase_seconds_count{phase=\"%s\"} %" PRIu64 "\n",
+            phase_names[phase], pHistogram->count);
+    }
+
+    #undef METRIC
+    #undef APPEND
+    return length < page_size ? length : page_size - 1;
+}
+
+static void* metrics_serve(void* arg) {
+    static char page[METRICS_PAGE_SIZE];
+    char request[BUFFER_SIZE];
+    metrics_snapshot copy;
+
+    // A client that sends nothing or never reads is dropped after a timeout
+    struct timeval timeout = { .tv_sec = METRICS_CLIENT_TIMEOUT_SECONDS };
+
+    while (TRUE) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd == -1) {
+            if (errno == ECONNABORTED) 
+                continue;
+            // Listening socket was shut down by metrics_stop()
+            break;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        // A connection accepted as metrics_stop() runs is not answered
+        pthread_mutex_lock(&client_lock);
+        bool stopped = stopping;
+        client_fd = stopped ? -1 : fd;
+        pthread_mutex_unlock(&client_lock);
+        if (stopped) {
+            close(fd);
+            break;
+        }
+
+        // Every request gets the metrics page, so the request is only drained
+        recv(fd, request, sizeof(request), 0);
+
+        snapshot_read(&copy);
+        size_t body_length = metrics_format(&copy, page, sizeof(page));
+        char header[256];
+        int header_length = snprintf(header, sizeof(header), 
+            "HTTP/1.0 200 OK\r\n"
+            "Content-Type: text/plain; version=0.0.4\r\n"
+            "Content-Length: %zu\r\n"
+            "\r\n", body_length);
+        send(fd, header, header_length, MSG_NOSIGNAL);
+        send(fd, page, body_length, MSG_NOSIGNAL);
+
+        // metrics_stop() never shuts down a descriptor after it is reused
+        pthread_mutex_lock(&client_lock);
+        client_fd = -1;
+        close(fd);
+        pthread_mutex_unlock(&client_lock);
+    }
+    return NULL;
+}
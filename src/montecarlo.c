@@ -0,0 +1,224 @@
+#include "montecarlo.h"
+#include "report.h"
+#include "simulation.h"
+#include "thread_pool.h"
+#include <inttypes.h>
+
+#define MONTECARLO_MAX_MEMORY 2048
+#define MONTECARLO_METRICS 3
+
+// Every variant is simulated under each of these
+static const char* scheduler_names[] = { "SJF", "SJF-M", "RR", "CP" };
+static const MEMORY_STRATEGY strategies[] = { INFINITE, BEST_FIT };
+static const char* strategy_names[] = { "infinite", "best-fit" };
+#define MONTECARLO_SCHEDULERS (sizeof(scheduler_names)/sizeof(scheduler_names[0]))
+#define MONTECARLO_STRATEGIES (sizeof(strategies)/sizeof(strategies[0]))
+#define MONTECARLO_CONFIGS (MONTECARLO_SCHEDULERS*MONTECARLO_STRATEGIES)
+
+// Two-sided 95% quantiles of Student's t distribution, indexed by degrees of freedom
+static const double t_quantiles[] = {
+    0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+/**
+ * @param pTemplate programs of the template input file
+ * @param program_count number of programs in the template
+ * @param pConfig pointer to configuration
+ * @param pResults results of every configuration of every variant, variant major
+*/
+typedef struct montecarlo_context {
+    const program* pTemplate;
+    uint32_t program_count;
+    const montecarlo_config* pConfig;
+    simulation_result* pResults;
+} montecarlo_context;
+
+/**
+ * @brief
+ * Draws the next number of a splitmix64 random stream.
+ * @param pState pointer to state of the stream
+ * @return
+ * Uniformly distributed 64 bit number
+*/
+static uint64_t montecarlo_next(uint64_t* pState);
+
+/**
+ * @brief
+ * Draws a uniformly distributed number in (0, 1).
+ * @param pState pointer to state of the stream
+*/
+static double montecarlo_uniform(uint64_t* pState);
+
+/**
+ * @brief
+ * Draws a standard normally distributed number with the Box-Muller transform.
+ * @param pState pointer to state of the stream
+*/
+static double montecarlo_normal(uint64_t* pState);
+
+/**
+ * @brief
+ * Builds a variant of the template and simulates it under every
+ * configuration. Called by the thread pool.
+ * @param variant index of the variant
+ * @param pContext pointer to montecarlo_context
+*/
+static void montecarlo_run_variant(uint32_t variant, void* pContext);
+
+/**
+ * @brief
+ * Prints the mean of a sample and the half width of its 95% confidence interval.
+ * @param name name of the metric
+ * @param pSamples pointer to samples
+ * @param count number of samples, at least 2
+*/
+static void montecarlo_print_interval(const char* name, const double* pSamples, uint32_t count);
+
+void montecarlo_run(const char* filename, const montecarlo_config* pConfig) {
+    assert(filename != NULL);
+    assert(pConfig != NULL);
+
+    if (pConfig->variant_count < 2) {
+        errx(EXIT_FAILURE, "Monte-Carlo evaluation needs at least 2 variants");
+    }
+    if (pConfig->quantum == 0) {
+        errx(EXIT_FAILURE, "Monte-Carlo evaluation needs a quantum");
+    }
+
+    montecarlo_context context = {
+        .pConfig = pConfig,
+        .pResults = calloc(pConfig->variant_count*MONTECARLO_CONFIGS, sizeof(simulation_result)),
+    };
+    program* pTemplate = simulation_load(filename, &context.program_count);
+    context.pTemplate = pTemplate;
+
+    double start = wall_time();
+    uint32_t thread_count = thread_pool_run(pConfig->variant_count, pConfig->thread_count,
+        montecarlo_run_variant, &context);
+    double elapsed = wall_time() - start;
+
+    printf("Monte-Carlo %u variants of %u programs, seed %" PRIu64 ", 95%% confidence intervals\n",
+        pConfig->variant_count, context.program_count, pConfig->seed);
+
+    // Samples of one metric of one configuration across every variant
+    double* pSamples = malloc(sizeof(double)*pConfig->variant_count);
+    for (uint32_t c=0; c<MONTECARLO_CONFIGS; c++) {
+        printf("%s %s", scheduler_names[c / MONTECARLO_STRATEGIES], strategy_names[c % MONTECARLO_STRATEGIES]);
+        for (uint32_t metric=0; metric<MONTECARLO_METRICS; metric++) {
+            for (uint32_t v=0; v<pConfig->variant_count; v++) {
+                simulation_result* pResult = &context.pResults[v*MONTECARLO_CONFIGS + c];
+                pSamples[v] = metric == 0 ? pResult->turnaround_time :
+                              metric == 1 ? pResult->avg_overhead : pResult->makespan;
+            }
+            static const char* metric_names[] = { "turnaround", "overhead", "makespan" };
+            montecarlo_print_interval(metric_names[metric], pSamples, pConfig->variant_count);
+        }
+        printf("\n");
+    }
+    FREE(pSamples);
+
+    // Timing varies between runs, so it goes to stderr like other diagnostics
+    fprintf(stderr, "Monte-Carlo simulated %u runs on %u threads in %.3fs\n",
+        pConfig->variant_count*(uint32_t)MONTECARLO_CONFIGS, thread_count, elapsed);
+
+    simulation_free(&pTemplate, context.program_count);
+    FREE(context.pResults);
+}
+
+static uint64_t montecarlo_next(uint64_t* pState) {
+    uint64_t z = (*pState += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static double montecarlo_uniform(uint64_t* pState) {
+    // 53 random bits, offset by half a step so 0 is never drawn
+    return ((montecarlo_next(pState) >> 11) + 0.5) / (double)(1ULL << 53);
+}
+
+static double montecarlo_normal(uint64_t* pState) {
+    double u1 = montecarlo_uniform(pState);
+    double u2 = montecarlo_uniform(pState);
+    return sqrt(-2*log(u1)) * cos(2*M_PI*u2);
+}
+
+static void montecarlo_run_variant(uint32_t variant, void* pContext) {
+    montecarlo_context* pMonteCarlo = pContext;
+    const montecarlo_config* pConfig = pMonteCarlo->pConfig;
+    uint32_t count = pMonteCarlo->program_count;
+
+    // Streams of different variants start far apart
+    uint64_t state = pConfig->seed ^ ((uint64_t)(variant + 1) * 0xd1b54a32d192ed03ULL);
+    program* pVariant = malloc(sizeof(program)*(count > 0 ? count : 1));
+    uint32_t previous_arrival = 0;
+    for (uint32_t i=0; i<count; i++) {
+        const program* pProgram = &pMonteCarlo->pTemplate[i];
+        simulation_copy_program(&pVariant[i], pProgram);
+
+        // Jitter the gap since the previous arrival, which keeps arrival order
+        int64_t gap = i == 0 ? pProgram->time_arrived :
+            (int64_t)pProgram->time_arrived - pMonteCarlo->pTemplate[i - 1].time_arrived;
+        if (pConfig->arrival_jitter > 0) {
+            gap += (int64_t)(montecarlo_next(&state) % (2*(uint64_t)pConfig->arrival_jitter + 1))
+                - pConfig->arrival_jitter;
+        }
+        pVariant[i].time_arrived = previous_arrival + (gap > 0 ? gap : 0);
+        previous_arrival = pVariant[i].time_arrived;
+
+        // Scale every CPU burst by the same factor, leaving I/O untouched
+        double factor = 1 + pConfig->service_noise*montecarlo_normal(&state);
+        if (factor < 0) factor = 0;
+        if (pVariant[i].pBursts == NULL) {
+            double service_time = round(pProgram->service_time*factor);
+            pVariant[i].service_time = service_time > 1 ? service_time : 1;
+        } else {
+            pVariant[i].service_time = 0;
+            for (uint32_t b=0; b<pVariant[i].burst_count; b+=2) {
+                double burst = round(pProgram->pBursts[b]*factor);
+                pVariant[i].pBursts[b] = burst > 1 ? burst : 1;
+                pVariant[i].service_time += pVariant[i].pBursts[b];
+            }
+        }
+
+        double memory = round(pProgram->memory_required*(1 + pConfig->memory_noise*montecarlo_normal(&state)));
+        pVariant[i].memory_required = memory < 1 ? 1 :
+            memory > MONTECARLO_MAX_MEMORY ? MONTECARLO_MAX_MEMORY : memory;
+    }
+
+    for (uint32_t c=0; c<MONTECARLO_CONFIGS; c++) {
+        simulation_config config = {
+            .scheduler_name = scheduler_names[c / MONTECARLO_STRATEGIES],
+            .strategy = strategies[c % MONTECARLO_STRATEGIES],
+            .quantum = pConfig->quantum,
+            .costs = pConfig->costs,
+        };
+        simulation_run(pVariant, count, &config, &pMonteCarlo->pResults[variant*MONTECARLO_CONFIGS + c]);
+    }
+    simulation_free(&pVariant, count);
+}
+
+static void montecarlo_print_interval(const char* name, const double* pSamples, uint32_t count) {
+    assert(count >= 2);
+
+    double mean = 0;
+    for (uint32_t i=0; i<count; i++) {
+        mean += pSamples[i];
+    }
+    mean /= count;
+
+    double variance = 0;
+    for (uint32_t i=0; i<count; i++) {
+        variance += (pSamples[i] - mean)*(pSamples[i] - mean);
+    }
+    variance /= count - 1;
+
+    // Large samples are close enough to normal
+    uint32_t degrees = count - 1;
+    uint32_t table_size = sizeof(t_quantiles)/sizeof(t_quantiles[0]);
+    double t = degrees < table_size ? t_quantiles[degrees] :
+               degrees <= 60 ? 2.000 : degrees <= 120 ? 1.980 : 1.960;
+    printf(" %s %.2f +-%.2f", name, mean, t*sqrt(variance/count));
+}
@@ -0,0 +1,242 @@
+#include <pipeline.h>
+#include <spsc_queue.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+// A stalled stage yields this many times before it starts sleeping, so it
+// does not take CPU time from the stage it is waiting on
+#define PIPELINE_YIELD_LIMIT 64
+#define PIPELINE_SLEEP_NANOSECONDS 20000
+
+/**
+ * @param count number of times the stage waited on a queue
+ * @param seconds wall-clock time spent waiting
+ * @param attempts failed attempts in the current stall
+*/
+typedef struct pipeline_stall {
+    uint64_t count;
+    double seconds;
+    uint64_t attempts;
+} pipeline_stall;
+
+typedef enum pipeline_stage {
+    STAGE_PARSE,            // Parser waiting on a full program queue
+    STAGE_SIMULATE_INPUT,   // Execution loop waiting on an empty program queue
+    STAGE_SIMULATE_OUTPUT,  // Execution loop waiting on a full event queue
+    STAGE_FORMAT,           // Formatter waiting on an empty event queue
+    STAGE_COUNT
+} PIPELINE_STAGE;
+
+static const char* stage_names[STAGE_COUNT] = {
+    "parse",
+    "simulate-input",
+    "simulate-output",
+    "format",
+};
+
+static spsc_queue* queue_programs = NULL;
+static spsc_queue* queue_events = NULL;
+static pthread_t parser_thread;
+static pthread_t formatter_thread;
+static FILE* fp_input = NULL;
+static pipeline_stall stalls[STAGE_COUNT] = {};
+
+// Written by the parser, read after it is joined
+static uint64_t fingerprint = FINGERPRINT_SEED;
+static uint64_t trace_bytes = 0;
+static double parse_seconds = 0;
+
+// Execution loop state
+static bool parsed_all = FALSE;
+static bool added_any = FALSE;
+static uint32_t last_arrival = 0;
+
+/**
+ * @brief
+ * Parses the input file into the program queue, then closes it.
+ * @param pArg unused
+*/
+static void* pipeline_parse(void* pArg);
+
+/**
+ * @brief
+ * Prints events from the event queue until it is closed and drained.
+ * @param pArg unused
+*/
+static void* pipeline_format(void* pArg);
+
+/**
+ * @brief
+ * Event sink of the process manager, pushes events to the formatter.
+ * @param pEvent pointer to event
+ * @param pContext unused
+*/
+static void pipeline_emit(const run_event* pEvent, void* pContext);
+
+/**
+ * @brief
+ * Waits for the next attempt at a queue operation, counting the stall.
+ * @param stage stage that is waiting
+ * @param pStart wall-clock time the stall started, or 0 on the first wait
+*/
+static void pipeline_wait(PIPELINE_STAGE stage, double* pStart);
+
+/**
+ * @brief
+ * Ends a stall started by pipeline_wait(), if there was one.
+ * @param stage stage that was waiting
+ * @param start wall-clock time the stall started, or 0 if there was none
+*/
+static void pipeline_end_stall(PIPELINE_STAGE stage, double start);
+
+bool pipeline_start(process_manager manager, const char* filename) {
+    assert(manager != NULL);
+    assert(filename != NULL);
+
+    fp_input = fopen(filename, "r");
+    if (fp_input == NULL)
+        return FALSE;
+
+    memset(stalls, 0, sizeof(stalls));
+    fingerprint = FINGERPRINT_SEED;
+    trace_bytes = 0;
+    parsed_all = FALSE;
+    added_any = FALSE;
+    last_arrival = 0;
+    queue_programs = spsc_queue_create(sizeof(program), PIPELINE_PROGRAM_CAPACITY);
+    queue_events = spsc_queue_create(sizeof(run_event), PIPELINE_EVENT_CAPACITY);
+    set_event_sink(manager, pipeline_emit, NULL);
+
+    if (pthread_create(&parser_thread, NULL, pipeline_parse, NULL) != 0 ||
+        pthread_create(&formatter_thread, NULL, pipeline_format, NULL) != 0) {
+        errx(EXIT_FAILURE, "cannot start pipeline threads");
+    }
+    return TRUE;
+}
+
+bool pipeline_admit(process_manager manager) {
+    assert(manager != NULL);
+
+    if (parsed_all)
+        return FALSE;
+
+    run_gauges gauges;
+    process_manager_get_gauges(manager, &gauges);
+
+    double start = 0;
+    while (!added_any || last_arrival <= gauges.time) {
+        program new_program;
+        if (spsc_queue_try_pop(queue_programs, &new_program)) {
+            program_add(manager, &new_program);
+            added_any = TRUE;
+            last_arrival = new_program.time_arrived;
+            continue;
+        }
+        if (spsc_queue_drained(queue_programs)) {
+            parsed_all = TRUE;
+            break;
+        }
+        pipeline_wait(STAGE_SIMULATE_INPUT, &start);
+    }
+    pipeline_end_stall(STAGE_SIMULATE_INPUT, start);
+    return !parsed_all;
+}
+
+void pipeline_stop(report* pReport) {
+    assert(pReport != NULL);
+    assert(parsed_all);
+
+    spsc_queue_close(queue_events);
+    pthread_join(formatter_thread, NULL);
+    pthread_join(parser_thread, NULL);
+    spsc_queue_destroy(&queue_programs);
+    spsc_queue_destroy(&queue_events);
+    fflush(stdout);
+
+    pReport->fingerprint = fingerprint;
+    pReport->trace_bytes = trace_bytes;
+    pReport->parse_seconds = parse_seconds;
+
+    fprintf(stderr, "Pipeline stalls");
+    for (uint32_t i=0; i<STAGE_COUNT; i++) {
+        fprintf(stderr, " %s %" PRIu64 " (%.3fs)", stage_names[i],
+            stalls[i].count, stalls[i].seconds);
+    }
+    fprintf(stderr, "\n");
+}
+
+static void* pipeline_parse(void* pArg) {
+    double start_time = wall_time();
+
+    char* line = NULL;
+    size_t line_size = 0;
+    uint32_t line_number = 0;
+    ssize_t line_length;
+    while((line_length = getline(&line, &line_size, fp_input)) != -1) {
+        fingerprint = fingerprint_update(fingerprint, line, line_length);
+        trace_bytes += line_length;
+
+        program new_program = {};
+        if (!program_parse(line, ++line_number, &new_program))
+            continue;
+
+        double start = 0;
+        while (!spsc_queue_try_push(queue_programs, &new_program)) {
+            pipeline_wait(STAGE_PARSE, &start);
+        }
+        pipeline_end_stall(STAGE_PARSE, start);
+    }
+    FREE(line);
+    fclose(fp_input);
+    fp_input = NULL;
+
+    parse_seconds = wall_time() - start_time;
+    spsc_queue_close(queue_programs);
+    return NULL;
+}
+
+static void* pipeline_format(void* pArg) {
+    run_event event;
+    while (TRUE) {
+        double start = 0;
+        while (!spsc_queue_try_pop(queue_events, &event)) {
+            if (spsc_queue_drained(queue_events)) {
+                pipeline_end_stall(STAGE_FORMAT, start);
+                return NULL;
+            }
+            pipeline_wait(STAGE_FORMAT, &start);
+        }
+        pipeline_end_stall(STAGE_FORMAT, start);
+        event_print(stdout, &event);
+    }
+}
+
+static void pipeline_emit(const run_event* pEvent, void* pContext) {
+    double start = 0;
+    while (!spsc_queue_try_push(queue_events, pEvent)) {
+        pipeline_wait(STAGE_SIMULATE_OUTPUT, &start);
+    }
+    pipeline_end_stall(STAGE_SIMULATE_OUTPUT, start);
+}
+
+static void pipeline_wait(PIPELINE_STAGE stage, double* pStart) {
+    if (*pStart == 0) {
+        *pStart = wall_time();
+        stalls[stage].count++;
+        stalls[stage].attempts = 0;
+    }
+    if (stalls[stage].attempts++ < PIPELINE_YIELD_LIMIT) {
+        sched_yield();
+    } else {
+        struct timespec duration = { .tv_sec = 0, .tv_nsec = PIPELINE_SLEEP_NANOSECONDS };
+        nanosleep(&duration, NULL);
+    }
+}
+
+static void pipeline_end_stall(PIPELINE_STAGE stage, double start) {
+    if (start != 0) {
+        stalls[stage].seconds += wall_time() - start;
+    }
+}
@@ -0,0 +1,90 @@
+#include <priority_queue.h>
+
+#define PRIORITY_QUEUE_INITIAL_CAPACITY 16
+
+static void swap(void** ppData1, void** ppData2) {
+    void* pTmp = *ppData1;
+    *ppData1 = *ppData2;
+    *ppData2 = pTmp;
+}
+
+priority_queue* priority_queue_create(int32_t (*cmp)(void*, void*)) {
+    assert(cmp != NULL);
+
+    priority_queue* pQueue = malloc(sizeof(priority_queue));
+    pQueue->ppData = malloc(sizeof(void*)*PRIORITY_QUEUE_INITIAL_CAPACITY);
+    pQueue->size = 0;
+    pQueue->capacity = PRIORITY_QUEUE_INITIAL_CAPACITY;
+    pQueue->cmp = cmp;
+    return pQueue;
+}
+
+void priority_queue_destroy(priority_queue** ppQueue) {
+    if (*ppQueue == NULL) return;
+
+    FREE((*ppQueue)->ppData);
+    (*ppQueue)->size = 0;
+    (*ppQueue)->capacity = 0;
+    FREE((*ppQueue));
+}
+
+void priority_queue_push(priority_queue* pQueue, void* pData) {
+    assert(pQueue != NULL);
+    assert(pData != NULL);
+
+    // Grow the heap array if it is full
+    if (pQueue->size == pQueue->capacity) {
+        pQueue->capacity *= 2;
+        pQueue->ppData = realloc(pQueue->ppData, sizeof(void*)*pQueue->capacity);
+    }
+
+    // Insert at the bottom of the heap and sift up
+    uint32_t index = pQueue->size++;
+    pQueue->ppData[index] = pData;
+    while(index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if (pQueue->cmp(pQueue->ppData[index], pQueue->ppData[parent]) >= 0) 
+            break;
+        swap(&pQueue->ppData[index], &pQueue->ppData[parent]);
+        index = parent;
+    }
+}
+
+void* priority_queue_peek(priority_queue* pQueue) {
+    assert(pQueue != NULL);
+    return pQueue->size > 0 ? pQueue->ppData[0] : NULL;
+}
+
+void* priority_queue_pop(priority_queue* pQueue) {
+    assert(pQueue != NULL);
+
+    if (pQueue->size == 0) 
+        return NULL;
+
+    // Move the last element to the root and sift down
+    void* pTop = pQueue->ppData[0];
+    pQueue->ppData[0] = pQueue->ppData[--pQueue->size];
+
+    uint32_t index = 0;
+    while(TRUE) {
+        uint32_t left = 2*index + 1;
+        uint32_t right = left + 1;
+        uint32_t smallest = index;
+
+        if (left < pQueue->size && 
+            pQueue->cmp(pQueue->ppData[left], pQueue->ppData[smallest]) < 0) {
+            smallest = left;
+        }
+        if (right < pQueue->size && 
+            pQueue->cmp(pQueue->ppData[right], pQueue->ppData[smallest]) < 0) {
+            smallest = right;
+        }
+        if (smallest == index) 
+            break;
+
+        swap(&pQueue->ppData[index], &pQueue->ppData[smallest]);
+        index = smallest;
+    }
+
+    return pTop;
+}
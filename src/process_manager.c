@@ -1,50 +1,73 @@
+#define _GNU_SOURCE // sched_setaffinity() and sched_getcpu()
+
 #include "process_manager.h"
 #include "linked_list.h"
-
-static uint32_t time = 0;
+#include "priority_queue.h"
+#include "scheduler.h"
+#include "counters.h"
+#include "histogram.h"
+#include "accounting.h"
+#include "trace.h"
+#include "logger.h"
+#include "report.h"
+#include "sha256.h"
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+
+static THREAD_LOCAL uint32_t time = 0;
 
 /** Process Manager
  * main should not be aware of what a process is, so declarations for
- * process related operations and data are located here instead of in 
- * process_manager.h. This also means that a lot of state is statically defined 
- * instead of being located in the definition of process_manager_t (lists, current running
- * process etc.)
+ * process related operations and data are located here and in scheduler.h 
+ * instead of in process_manager.h. This also means that a lot of state is 
+ * statically defined instead of being located in the definition of 
+ * process_manager_t (lists, current running process etc.)
 */
 
-typedef enum process_state {
-    READY,
-    RUNNING,
-    FINISHED
-} PROCESS_STATE;
-
-typedef struct memory_block {
-    uint32_t index;
-    uint32_t size;
-} memory_block;
-
-typedef struct process {
-    program* pProgram;
-    uint32_t run_time;
-    PROCESS_STATE state;
-    memory_block* pBlock;
-    pid_t child_pid;        
-    int P2Cfd[2];   // Parent to Child File Descriptors
-    int C2Pfd[2];   // Child to Parent File Descriptors
-    char sha_buf[SHA_HASH_SIZE + 1];
-} process;
-
 // Static process manager state
-static uint8_t initialised = FALSE;
-static process_manager_t instance = {};
-static list* list_input = NULL; // Programs waiting to be subitted to the ready list
-static list* list_active = NULL; // All ready, running and finished processes
-static list* list_ready = NULL; // Processes ready to begin or resume execution
-static process* pRunningProcess = NULL; // Current running process
+static THREAD_LOCAL uint8_t initialised = FALSE;
+static THREAD_LOCAL process_manager_t instance = {};
+static THREAD_LOCAL list* list_input = NULL; // Programs waiting to be subitted to the ready list
+static THREAD_LOCAL list* list_active = NULL; // All ready, running and finished processes
+static THREAD_LOCAL list* list_ready = NULL; // Processes ready to begin or resume execution
+static THREAD_LOCAL priority_queue* queue_blocked = NULL; // Processes waiting on I/O, ordered by wake time
+static THREAD_LOCAL process* pRunningProcess = NULL; // Current running process
+static THREAD_LOCAL uint32_t arrival_index = 0; // Index of the next program to arrive
+static THREAD_LOCAL run_gauges gauges = {}; // Kept up to date as the lists change
 
 // Runtime statistics
-static float max_overhead = 0;
-static float avg_overhead = 0;
-static float turnaround_time = 0;
+static THREAD_LOCAL float max_overhead = 0;
+static THREAD_LOCAL float avg_overhead = 0;
+static THREAD_LOCAL float turnaround_time = 0;
+static THREAD_LOCAL uint32_t busy_time = 0;
+static THREAD_LOCAL child_stats children = {}; // Real resource usage of reaped children
+static THREAD_LOCAL bool has_io = FALSE;
+static THREAD_LOCAL histogram turnaround_histogram = {};
+static THREAD_LOCAL histogram waiting_histogram = {};    // Time spent neither running nor BLOCKED
+static THREAD_LOCAL histogram response_histogram = {};   // Time from arrival to first run
+static THREAD_LOCAL histogram overhead_histogram = {};   // Time overhead in hundredths
+static THREAD_LOCAL histogram round_trip_histogram = {}; // Nanoseconds per exchange with a child
+
+// Lower bounds only depend on the programs, so they are computed once
+static THREAD_LOCAL bool bounds_dirty = TRUE;
+static THREAD_LOCAL uint32_t turnaround_bound = 0;
+static THREAD_LOCAL uint32_t makespan_bound = 0;
+
+// CPU children are pinned to, or -1 if children are not pinned
+static THREAD_LOCAL int32_t child_cpu = -1;
+
+// Speculative spawning
+static THREAD_LOCAL process* pSpeculative = NULL; // Process whose child was spawned speculatively
+static THREAD_LOCAL uint32_t last_quantum = 0;
+static THREAD_LOCAL uint32_t speculative_spawns = 0;
+static THREAD_LOCAL uint32_t speculative_hits = 0;
+
+// Time series samples only walk the free list when it has changed since the
+// last sample, which is when allocations plus frees differ from the version
+static THREAD_LOCAL uint64_t sampled_version = UINT64_MAX;
+static THREAD_LOCAL uint32_t sampled_largest_free = 0;
 
 /**
  * @brief
@@ -74,14 +97,48 @@ static void process_submit_ready(process* pProcess);
 /**
  * @brief
  * Sets a ready process to run for the first time, or continues a
- * process that was previously suspended.
+ * process that was previously suspended. Charges the spawn or resume
+ * cost to simulation time.
  * @param pProcess pointer to an ACTIVE process
 */
 static void process_run(process* pProcess);
 
 /**
  * @brief
- * Signals to a running process to stop execution.
+ * Forks and execs the child of a process, without sending START.
+ * @param pProcess pointer to a process without a child
+*/
+static void process_spawn(process* pProcess);
+
+/**
+ * @brief
+ * Stores bytes into the hash buffer of an emulated child exactly like 
+ * ./process does, including the way it advances its index.
+ * @param pProcess pointer to a process with an emulated child
+ * @param pBuf pointer to bytes to store
+ * @param nbytes number of bytes to store
+*/
+static void emulated_store(process* pProcess, const void* pBuf, size_t nbytes);
+
+/**
+ * @brief
+ * Sends START to a spawned child and verifies the acknowledgement.
+ * @param pProcess pointer to a process whose child has not been started
+*/
+static void process_start(process* pProcess);
+
+/**
+ * @brief
+ * Spawns the child of the process the scheduler would pick next, if the 
+ * next dispatch is at most one quantum away and no speculative child is 
+ * already waiting.
+*/
+static void process_speculate();
+
+/**
+ * @brief
+ * Signals to a running process to stop execution. Charges the suspend
+ * cost to simulation time.
  * @param pProcess pointer to a running process
 */
 static void process_suspend(process* pProcess);
@@ -94,11 +151,27 @@ static void process_suspend(process* pProcess);
 */
 static void process_continue(process* pProcess);
 
+/**
+ * @brief
+ * Suspends a running process that has finished its current CPU burst
+ * and places it in the blocked queue until its I/O burst completes.
+ * @param pProcess pointer to a running process
+ * @param block_time time the CPU burst ended, which may be inside the quantum
+*/
+static void process_block(process* pProcess, uint32_t block_time);
+
+/**
+ * @brief
+ * Submits every blocked process whose I/O burst has completed to the
+ * ready list.
+*/
+static void process_wake_blocked();
+
 /**
  * @brief
  * Signals to a running process to terminate. Also closes pipes between
  * the parent process and its child, not before retrieving a sha hash string
- * from the terminated process.
+ * from the terminated process. Charges the terminate cost to simulation time.
  * @param pProcess pointer to a running process
 */
 static void process_terminate(process* pProcess);
@@ -114,9 +187,10 @@ static void process_terminate(process* pProcess);
 typedef struct memory_allocator {
     list* free_list;
     MEMORY_STRATEGY strategy;
+    allocator_stats stats;
 } memory_allocator;
 
-static memory_allocator allocator = {};
+static THREAD_LOCAL memory_allocator allocator = {};
 
 /**
  * @brief
@@ -131,6 +205,13 @@ static void allocator_initialise(MEMORY_STRATEGY strategy);
 */
 static void allocator_destroy();
 
+/**
+ * @brief
+ * Fills in the free list statistics of the allocator's stats, which are
+ * too expensive to maintain on every allocation.
+*/
+static void allocator_update_stats();
+
 /**
  * @brief
  * Allocator attempts to find a block of memory large enough to fit
@@ -151,25 +232,219 @@ static memory_block* allocator_find_best_fit(uint32_t size);
 */
 static void allocater_free_memory(process* pProcess);
 
-// Task 1 and 2
+/** Dependencies
+ * Programs can only depend on programs that were added before them, so the
+ * order programs are added in is always a topological order of the dependency
+ * graph. This means cycles are impossible and critical paths can be found in
+ * one backwards pass over the programs.
+*/
+
+typedef struct dependency_node {
+    uint32_t* pSuccessors;      // Indices of programs that depend on this program
+    uint32_t successor_count;
+    uint32_t successor_capacity;
+    uint32_t* pPredecessors;    // Indices of programs this program depends on
+    uint32_t predecessor_count;
+    uint32_t predecessor_capacity;
+    uint32_t unfinished_count;  // Number of predecessors that are yet to finish
+    bool arrived;
+    bool finished;
+    bool queued;                // Waiting in queue_critical for its path to be recomputed
+} dependency_node;
+
+static THREAD_LOCAL dependency_node* pDependencies = NULL; // Indexed like programs
+static THREAD_LOCAL uint32_t program_capacity = 0;
+static THREAD_LOCAL uint32_t chunk_capacity = 0; // Length of instance.ppProgramChunks
+static THREAD_LOCAL uint32_t* pNameTable = NULL; // Open addressing table of program index + 1, keyed by name
+static THREAD_LOCAL uint32_t name_table_capacity = 0;
+static THREAD_LOCAL bool critical_path_dirty = FALSE;
+static THREAD_LOCAL priority_queue* queue_critical = NULL; // Programs whose critical path may have grown, latest first
+
+/**
+ * @brief
+ * Resolves the dependency string of a newly added program, linking it to
+ * the programs it depends on. Also frees the dependency string.
+ * @param index index of the newly added program
+*/
+static void dependencies_add(uint32_t index);
+
+/**
+ * @brief
+ * Notifies programs that depend on a finished program. Programs whose
+ * predecessors have all finished are submitted to the input list if they
+ * have arrived. Takes O(out-degree) time.
+ * @param pProgram pointer to the program of a FINISHED process
+*/
+static void dependencies_release(program* pProgram);
+
+/**
+ * @brief
+ * Recomputes the critical paths of the programs queued since the last update,
+ * latest first so each is recomputed once after all of its successors. The
+ * predecessors of a program are only queued if its critical path grew, and
+ * finished programs are never queued since no scheduler ranks them again.
+*/
+static void dependencies_update_critical_path();
+
+/**
+ * @brief
+ * Queues an unfinished program for dependencies_update_critical_path().
+ * @param index index of the program
+*/
+static void dependencies_queue_critical_path(uint32_t index);
+
+/**
+ * @brief
+ * Appends a program index to a growable array of indices.
+ * @param ppIndices pointer to the heap allocated array
+ * @param pCount pointer to the number of indices in the array
+ * @param pCapacity pointer to the capacity of the array
+ * @param index program index to append
+*/
+static void dependencies_append(uint32_t** ppIndices, uint32_t* pCount, 
+    uint32_t* pCapacity, uint32_t index);
+
+/**
+ * @param name name of a program
+ * @return
+ * Index of the most recently added program with the given name, or 
+ * instance.program_count if no such program exists.
+*/
+static uint32_t name_table_find(const char* name);
+
+/**
+ * @brief
+ * Inserts a program into the name table, growing the table if needed.
+ * @param index index of the program
+*/
+static void name_table_insert(uint32_t index);
+
+// Parsing
 
-static node* shortest_job_first(list* pList);
-static node* round_robin(list* pList);
+/**
+ * @brief
+ * Parses the burst length at the start of a field of the burst list.
+ * @param field pointer to the field
+ * @param pLength pointer to where the length is stored
+ * @return
+ * Pointer to the character after the length, or NULL if the field does not
+ * start with a length that fits in 32 bits
+*/
+static char* burst_parse(char* field, uint32_t* pLength);
 
 // Miscellaneous
 
 static uint32_t big_endian(uint32_t integer);
 static int32_t mem_block_cmp(void* pData1, void* pData2);
+static int32_t wake_time_cmp(void* pData1, void* pData2);
+static int32_t program_index_cmp(void* pData1, void* pData2);
 static void print_final_stats();
 
+/**
+ * @brief
+ * Computes lower bounds of the mean turnaround time and the makespan, if
+ * programs were added since they were last computed. Takes O(n log n) time.
+*/
+static void compute_lower_bounds();
+
+/**
+ * @brief
+ * Chooses the CPU the next child process is pinned to.
+ * @return
+ * CPU number, or -1 if children are not pinned
+*/
+static int32_t affinity_next_child_cpu();
+static void print_percentiles(const char* name, histogram* pHistogram, float scale, int32_t precision);
+
 // Wrapper functions
 
-static void fd_write(int fd, void* pBuf, size_t nbytes);
-static void fd_read(int fd, void* pBuf, size_t nbytes);
+
+/**
+ * @brief
+ * Writes exactly nbytes to a file descriptor. SIGPIPE is blocked during the
+ * write, so a closed reader is returned instead of killing the program.
+ * @param fd file descriptor
+ * @param pBuf pointer to buffer
+ * @param nbytes number of bytes
+ * @return
+ * Whether every byte was written. FALSE means the other end was closed.
+*/
+static bool fd_write(int fd, void* pBuf, size_t nbytes);
+
+/**
+ * @brief
+ * Reads exactly nbytes from a file descriptor.
+ * @param fd file descriptor
+ * @param pBuf pointer to buffer
+ * @param nbytes number of bytes
+ * @return
+ * Whether every byte was read. FALSE means the other end was closed first.
+*/
+static bool fd_read(int fd, void* pBuf, size_t nbytes);
+
+/**
+ * @brief
+ * Writes exactly nbytes to a child process, and reports it with 
+ * process_died() if it has exited.
+ * @param pProcess pointer to a process with a child
+ * @param pBuf pointer to buffer
+ * @param nbytes number of bytes
+*/
+static void process_write(process* pProcess, void* pBuf, size_t nbytes);
+
+/**
+ * @brief
+ * Reads exactly nbytes from a child process, and reports it with 
+ * process_died() if it closed its pipe.
+ * @param pProcess pointer to a process with a child
+ * @param pBuf pointer to buffer
+ * @param nbytes number of bytes
+*/
+static void process_read(process* pProcess, void* pBuf, size_t nbytes);
+
+/**
+ * @brief
+ * Reaps a child process that closed its pipes and exits the program, naming
+ * the process and how its child ended.
+ * @param pProcess pointer to a process with a child
+*/
+static void process_died(process* pProcess) __attribute__((noreturn));
+
+/**
+ * @brief
+ * Waits for the version byte a child sends after acknowledging START when
+ * asked for version 2 of the protocol.
+ * @param pProcess pointer to a process with a child
+ * @return
+ * Whether the child speaks version 2. A child that sends nothing within
+ * PROTOCOL_VERSION_TIMEOUT_MS only speaks version 1.
+*/
+static bool process_negotiate(process* pProcess);
+
+/**
+ * @brief
+ * Sends the current time to a child process, prefixed with an opcode when
+ * version 2 of the protocol is used after START.
+ * @param pProcess pointer to a process with a child
+ * @param op operation the time is sent for
+ * @return
+ * Last byte of the time, which the child sends back as acknowledgement
+*/
+static uint8_t process_send_time(process* pProcess, PROTOCOL_OP op);
+
+/**
+ * @brief
+ * Reads an acknowledgement byte from a child process, exiting the program 
+ * if it is not the expected byte.
+ * @param pProcess pointer to a process with a child
+ * @param expected expected byte
+ * @param operation name of the operation for the error message
+*/
+static void process_expect_ack(process* pProcess, uint8_t expected, const char* operation);
 
 void process_manager_initialise(
     process_manager* pManager, 
-    SCHEDULER_TYPE type, 
+    const char* scheduler_name, 
     MEMORY_STRATEGY strategy) {
 
     // Make sure manager is not already initialised
@@ -178,53 +453,361 @@ void process_manager_initialise(
     debug_log("\nINITIALISING PROCESS MANAGER\n\n");
 
     // Initialise variables needed by the process manager
-    instance.pPrograms = NULL;
+    instance.ppProgramChunks = NULL;
     instance.program_count = 0;
-    instance.type = type;
+    instance.pScheduler = scheduler_find(scheduler_name);
     instance.pending_count = 0;
+    memset(&instance.costs, 0, sizeof(cost_model));
+    memset(&gauges, 0, sizeof(run_gauges));
+    instance.report_flags = 0;
+    instance.protocol = PROTOCOL_SIGNALS;
+    instance.speculate = FALSE;
+    instance.pOutput = stdout;
+    instance.sink = NULL;
+    instance.pSinkContext = NULL;
     initialised = TRUE;
 
+    // A thread may run several simulations, so state left by the last one 
+    // is reset
+    time = 0;
+    pRunningProcess = NULL;
+    arrival_index = 0;
+    max_overhead = 0;
+    avg_overhead = 0;
+    turnaround_time = 0;
+    busy_time = 0;
+    memset(&children, 0, sizeof(child_stats));
+    has_io = FALSE;
+    memset(&turnaround_histogram, 0, sizeof(histogram));
+    memset(&waiting_histogram, 0, sizeof(histogram));
+    memset(&response_histogram, 0, sizeof(histogram));
+    memset(&overhead_histogram, 0, sizeof(histogram));
+    memset(&round_trip_histogram, 0, sizeof(histogram));
+    bounds_dirty = TRUE;
+    pSpeculative = NULL;
+    last_quantum = 0;
+    speculative_spawns = 0;
+    speculative_hits = 0;
+    sampled_version = UINT64_MAX;
+    sampled_largest_free = 0;
+    critical_path_dirty = FALSE;
+
     list_active = list_create(TRUE); // List nodes will carry heap allocated memory addresses to processes
-    list_input = list_create(FALSE); // References programs in instance.pPrograms[]
+    list_input = list_create(FALSE); // References programs in instance.ppProgramChunks
     list_ready = list_create(FALSE); // References processes in list_active
+    queue_blocked = priority_queue_create(wake_time_cmp); // References processes in list_active
+    queue_critical = priority_queue_create(program_index_cmp); // References programs in instance.ppProgramChunks
     allocator_initialise(strategy);
 
     *pManager = &instance; // Pass instance handle over to user
 }
 
+void process_manager_get_stats(process_manager manager, run_stats* pStats) {
+    assert(initialised);
+    assert(manager == &instance);
+    assert(pStats != NULL);
+
+    pStats->program_count = instance.program_count;
+    pStats->finished_count = turnaround_histogram.total;
+    pStats->turnaround_time = (uint32_t)ceilf(turnaround_time / (float)instance.program_count);
+    pStats->max_overhead = max_overhead;
+    pStats->avg_overhead = avg_overhead / (float)instance.program_count;
+    pStats->makespan = time;
+    pStats->cpu_utilisation = time > 0 ? busy_time / (float)time : 0.0f;
+    compute_lower_bounds();
+    pStats->turnaround_bound = turnaround_bound;
+    pStats->makespan_bound = makespan_bound;
+    pStats->pTurnaround = &turnaround_histogram;
+    pStats->pWaiting = &waiting_histogram;
+    pStats->pResponse = &response_histogram;
+    pStats->pOverhead = &overhead_histogram;
+    pStats->pRoundTrip = &round_trip_histogram;
+
+    allocator_update_stats();
+    pStats->allocator = allocator.stats;
+    pStats->children = children;
+}
+
+void process_manager_get_gauges(process_manager manager, run_gauges* pGauges) {
+    assert(initialised);
+    assert(manager == &instance);
+    assert(pGauges != NULL);
+
+    *pGauges = gauges;
+    pGauges->time = time;
+    pGauges->program_count = instance.program_count;
+    pGauges->blocked_depth = queue_blocked->size;
+    pGauges->memory_in_use = allocator.stats.in_use;
+}
+
+void process_manager_get_sample(process_manager manager, run_sample* pSample) {
+    assert(initialised);
+    assert(manager == &instance);
+    assert(pSample != NULL);
+
+    // Every allocation or free bumps the version, so the free list is only
+    // walked when it has changed
+    uint64_t version = allocator.stats.allocations + allocator.stats.frees;
+    if (version != sampled_version) {
+        allocator_update_stats();
+        sampled_largest_free = allocator.stats.largest_free;
+        sampled_version = version;
+    }
+
+    pSample->time = time;
+    pSample->input_depth = gauges.input_depth;
+    pSample->ready_depth = gauges.ready_depth;
+    pSample->memory_in_use = allocator.stats.in_use;
+    pSample->largest_free = sampled_largest_free;
+    pSample->running = pRunningProcess != NULL ? 
+        (int32_t)pRunningProcess->pProgram->index : -1;
+}
+
 void process_manager_destroy(process_manager* pManager) {
     assert(initialised);
     assert(*pManager == &instance);
 
     print_final_stats();
+    counters_print(stderr);
     debug_log("\nDESTROYING PROCESS MANAGER\n\n");
 
     allocator_destroy();
+    scheduler_unload();
+    priority_queue_destroy(&queue_blocked);
+    priority_queue_destroy(&queue_critical);
     list_destroy(&list_ready);
     list_destroy(&list_input);
     list_destroy(&list_active); // All process handles are freed after this point
-    memset(instance.pPrograms, 0, sizeof(program)*instance.program_count);
-    FREE(instance.pPrograms);
+    for (uint32_t i=0; i<instance.program_count; i++) {
+        FREE(program_at(&instance, i)->pBursts);
+        FREE(pDependencies[i].pSuccessors);
+        FREE(pDependencies[i].pPredecessors);
+    }
+    FREE(pDependencies);
+    FREE(pNameTable);
+    name_table_capacity = 0;
+    program_capacity = 0;
+    for (uint32_t i=0; i*PROGRAM_CHUNK_SIZE < instance.program_count; i++) {
+        FREE(instance.ppProgramChunks[i]);
+    }
+    FREE(instance.ppProgramChunks);
+    chunk_capacity = 0;
     memset(&instance, 0, sizeof(process_manager_t));
+    initialised = FALSE;
 
     *pManager = NULL; // User should not be able to use destroyed process manager
 }
 
+void set_cost_model(process_manager manager, cost_model* pCosts) {
+    assert(initialised);
+    assert(manager == &instance);
+    assert(pCosts != NULL);
+
+    instance.costs = *pCosts;
+}
+
+void set_report_flags(process_manager manager, uint32_t report_flags) {
+    assert(initialised);
+    assert(manager == &instance);
+
+    instance.report_flags = report_flags;
+}
+
+void set_affinity(process_manager manager, affinity* pAffinity) {
+    assert(initialised);
+    assert(manager == &instance);
+    assert(pAffinity != NULL);
+
+    instance.affinity = *pAffinity;
+    if (pAffinity->manager_cpu < 0) 
+        return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(pAffinity->manager_cpu, &set);
+    if (sched_setaffinity(0, sizeof(cpu_set_t), &set) == -1) {
+        err(EXIT_FAILURE, "cannot pin manager to CPU %d", pAffinity->manager_cpu);
+    }
+}
+
+void set_protocol(process_manager manager, uint32_t protocol) {
+    assert(initialised);
+    assert(manager == &instance);
+    assert(protocol == PROTOCOL_EMULATED || 
+        protocol == PROTOCOL_SIGNALS || 
+        protocol == PROTOCOL_MESSAGES);
+
+    instance.protocol = protocol;
+}
+
+void set_speculation(process_manager manager, bool speculate) {
+    assert(initialised);
+    assert(manager == &instance);
+
+    instance.speculate = speculate;
+}
+
+program* program_at(process_manager manager, uint32_t index) {
+    assert(manager != NULL);
+    assert(index < manager->program_count);
+
+    return &manager->ppProgramChunks[index >> PROGRAM_CHUNK_BITS][index & (PROGRAM_CHUNK_SIZE - 1)];
+}
+
+void set_output(process_manager manager, FILE* pOutput) {
+    assert(initialised);
+    assert(manager == &instance);
+
+    instance.pOutput = pOutput;
+}
+
+void set_event_sink(process_manager manager, event_sink sink, void* pContext) {
+    assert(initialised);
+    assert(manager == &instance);
+
+    instance.sink = sink;
+    instance.pSinkContext = pContext;
+}
+
+void event_print(FILE* fp, const run_event* pEvent) {
+    assert(fp != NULL);
+    assert(pEvent != NULL);
+
+    switch(pEvent->type) 
+    {
+        case(EVENT_READY):
+            fprintf(fp, "%d,READY,process_name=%s,assigned_at=%d\n",
+            pEvent->time,
+            pEvent->name,
+            pEvent->value);
+            break;
+        case(EVENT_RUNNING):
+            fprintf(fp, "%d,RUNNING,process_name=%s,remaining_time=%d\n",
+            pEvent->time,
+            pEvent->name,
+            pEvent->value);
+            break;
+        case(EVENT_BLOCKED):
+            fprintf(fp, "%d,BLOCKED,process_name=%s,wake_time=%d\n",
+            pEvent->time,
+            pEvent->name,
+            pEvent->value);
+            break;
+        case(EVENT_FINISHED):
+            fprintf(fp, "%d,FINISHED,process_name=%s,proc_remaining=%d\n",
+            pEvent->time,
+            pEvent->name,
+            pEvent->value);
+            fprintf(fp, "%d,FINISHED-PROCESS,process_name=%s,sha=%s\n",
+            pEvent->time,
+            pEvent->name,
+            pEvent->sha);
+            break;
+    }
+}
+
 void program_add(process_manager manager, program* pProgram) {
     assert(initialised);
     assert(manager == &instance);
 
+    // Grow dependency storage geometrically so large inputs load in linear time
+    if (instance.program_count == program_capacity) {
+        program_capacity = program_capacity == 0 ? 1 : program_capacity*2;
+        pDependencies = realloc(pDependencies, sizeof(dependency_node)*program_capacity);
+    }
+
+    // Programs are stored in chunks that never move, since processes and the 
+    // input list point to them while more programs are added
+    uint32_t index = instance.program_count;
+    uint32_t chunk = index >> PROGRAM_CHUNK_BITS;
+    if ((index & (PROGRAM_CHUNK_SIZE - 1)) == 0) {
+        if (chunk == chunk_capacity) {
+            chunk_capacity = chunk_capacity == 0 ? 1 : chunk_capacity*2;
+            instance.ppProgramChunks = realloc(instance.ppProgramChunks, sizeof(program*)*chunk_capacity);
+        }
+        instance.ppProgramChunks[chunk] = malloc(sizeof(program)*PROGRAM_CHUNK_SIZE);
+    }
+
     // Add process to manager
-    if (instance.program_count == 0) {
-        instance.program_count++;
-        instance.pPrograms = malloc(sizeof(program));
-        instance.pPrograms[0] = *pProgram;
+    instance.program_count++;
+    *program_at(&instance, index) = *pProgram;
+    program_at(&instance, index)->index = index;
+    memset(&pDependencies[index], 0, sizeof(dependency_node));
+    dependencies_add(index);
+    name_table_insert(index);
+    if (pProgram->pBursts != NULL) {
+        has_io = TRUE;
+    }
+    bounds_dirty = TRUE;
+    LOG(LOG_DEBUG, "Process %s added to process manager\n", pProgram->name);
+}
+
+bool program_parse(char* line, uint32_t line_number, program* pProgram) {
+    assert(line != NULL);
+    assert(pProgram != NULL);
+
+    char* bursts = malloc(strlen(line) + 1);
+    char* depends_on = malloc(strlen(line) + 1);
+    int32_t columns = sscanf(line, "%u %8s %s %hu %s", 
+                &pProgram->time_arrived, 
+                pProgram->name, 
+                bursts, 
+                &pProgram->memory_required,
+                depends_on);
+    if (columns < 4) {
+        FREE(bursts);
+        FREE(depends_on);
+        return FALSE;
+    }
+
+    // Process manager takes ownership of the dependency string
+    if (columns == 5) {
+        pProgram->pDependsOn = depends_on;
     } else {
-        instance.program_count++;
-        instance.pPrograms = realloc(instance.pPrograms, sizeof(program)*instance.program_count);
-        instance.pPrograms[instance.program_count - 1] = *pProgram;
+        FREE(depends_on);
     }
-   debug_log("Process %s added to process manager\n", pProgram->name);
+
+    // Plain service time, so the program never blocks on I/O
+    if (strchr(bursts, ',') == NULL) {
+        char* end = burst_parse(bursts, &pProgram->service_time);
+        if (end == NULL || *end != '\0') {
+            errx(EXIT_FAILURE, "line %u: %s has an invalid service time %s",
+                line_number, pProgram->name, bursts);
+        }
+        FREE(bursts);
+        return TRUE;
+    }
+
+    // Otherwise count bursts, which are separated by commas
+    uint32_t burst_count = 1;
+    for (char* c = bursts; *c != '\0'; c++) {
+        if (*c == ',') burst_count++;
+    }
+    if (burst_count % 2 == 0) {
+        errx(EXIT_FAILURE, "line %u: %s must start and end with a CPU burst",
+            line_number, pProgram->name);
+    }
+
+    // CPU bursts sit at even indices, I/O bursts at odd indices, and every
+    // field must hold a length, so empty fields and trailing commas are errors
+    pProgram->pBursts = malloc(sizeof(uint32_t)*burst_count);
+    pProgram->burst_count = burst_count;
+    pProgram->service_time = 0;
+    char* field = bursts;
+    for (uint32_t i=0; i<burst_count; i++) {
+        char* end = burst_parse(field, &pProgram->pBursts[i]);
+        if (end == NULL || *end != (i + 1 < burst_count ? ',' : '\0')) {
+            errx(EXIT_FAILURE, "line %u: %s has an invalid burst %u in %s",
+                line_number, pProgram->name, i + 1, bursts);
+        }
+        if (i % 2 == 0) {
+            pProgram->service_time += pProgram->pBursts[i];
+        }
+        field = end + 1;
+    }
+
+    FREE(bursts);
+    return TRUE;
 }
 
 void update(process_manager manager, uint32_t delta_time) {
@@ -233,42 +816,67 @@ void update(process_manager manager, uint32_t delta_time) {
 
     // Update time
     time += delta_time;
+    last_quantum = delta_time;
+    if (instance.pScheduler->on_tick != NULL) {
+        instance.pScheduler->on_tick(pRunningProcess, time);
+    }
 
     // If a running process exists, run it for one quantum
-    if (pRunningProcess == NULL) 
-        return;
-    pRunningProcess->run_time += delta_time;
-
     if (pRunningProcess != NULL) {
+        // A CPU burst that ends inside the quantum leaves the CPU idle for
+        // the rest of it, so run time never passes the end of the burst
+        uint32_t slice = pRunningProcess->burst_end - pRunningProcess->run_time;
+        if (slice > delta_time) {
+            slice = delta_time;
+        }
+        pRunningProcess->run_time += slice;
+        busy_time += slice;
+
         if (pRunningProcess->run_time >= pRunningProcess->pProgram->service_time) {
             instance.pending_count--;
             process_terminate(pRunningProcess);
             if (allocator.strategy == BEST_FIT) {
                 allocater_free_memory(pRunningProcess);
             }
+            dependencies_release(pRunningProcess->pProgram);
             process_log(pRunningProcess);
             pRunningProcess = NULL;
+        } else if (pRunningProcess->run_time >= pRunningProcess->burst_end) {
+            process_block(pRunningProcess, time - (delta_time - slice));
+            pRunningProcess = NULL;
         }
     }
+
+    // All decisions for this tick have been made
+    gauges.tick_count++;
+    counters_tick();
 }
 
 void check_pending(process_manager manager) {
     assert(initialised);
     assert(manager == &instance);
 
-    debug_log("Checking pending processes\n");
+    LOG(LOG_DEBUG, "Checking pending processes\n");
 
-    static uint32_t index = 0;
+    // Processes that finished their I/O are ready to run again
+    process_wake_blocked();
 
     // Check if the next program can be inserted into the input list
-    while(index < instance.program_count) {
-        program* pProgram = &instance.pPrograms[index];
+    while(arrival_index < instance.program_count) {
+        program* pProgram = program_at(&instance, arrival_index);
 
         if (pProgram->time_arrived > time) 
             break;
-        list_insert_tail(list_input, pProgram);
+
+        // Programs with unfinished predecessors are held back until
+        // dependencies_release() submits them
+        pDependencies[arrival_index].arrived = TRUE;
+        if (pDependencies[arrival_index].unfinished_count == 0) {
+            list_insert_tail(list_input, pProgram);
+            gauges.input_depth++;
+        }
         instance.pending_count++;
-        index++;
+        arrival_index++;
     }
 
     // return if there are no programs in the input list
@@ -280,6 +888,7 @@ void check_pending(process_manager manager) {
     // Iterate through input list and check if any program can
     // be submitted to the ready list
     while (pNode != NULL) {
+        COUNTER_ADD(COUNTER_PENDING_RETRIED, 1);
         program* pProgram = pNode->data;
         process* pProcess = process_try_create(pProgram);
 
@@ -292,6 +901,8 @@ void check_pending(process_manager manager) {
                 process_log(pProcess);
             }
             pNode = list_pop_node(list_input, pNode);
+            gauges.input_depth--;
+            gauges.admitted_count++;
             continue;
         }
 
@@ -306,23 +917,19 @@ bool keep_process_running(process_manager manager) {
     if (pRunningProcess == NULL) 
         return FALSE;
     
-    switch(instance.type) 
-    {
-    case(SJF):
-        process_continue(pRunningProcess);
-        break;
-    case(RR):
-        if (list_ready->head != NULL) {
-            process_suspend(pRunningProcess);
-            process_submit_ready(pRunningProcess);
-            pRunningProcess = NULL;
-            return FALSE;
-        } else {
-            process_continue(pRunningProcess);
-        }
-        break;
+    // Schedulers without a should_preempt hook never preempt
+    const scheduler* pScheduler = instance.pScheduler;
+    if (pScheduler->should_preempt != NULL && 
+        pScheduler->should_preempt(pRunningProcess, list_ready)) {
+        pRunningProcess->suspend_count++;
+        process_suspend(pRunningProcess);
+        process_submit_ready(pRunningProcess);
+        pRunningProcess = NULL;
+        return FALSE;
     }
 
+    process_continue(pRunningProcess);
+    process_speculate();
     return TRUE;
 }
 
@@ -330,19 +937,18 @@ void switch_process(process_manager manager) {
     assert(initialised);
     assert(manager == &instance);
 
-    node* pReady = NULL;
+    if (list_ready->head == NULL) 
+        return;
 
-    // Find valid ready process to run
-    switch(instance.type)
-    {
-        case(SJF):
-            pReady = shortest_job_first(list_ready);
-            break;
-        case(RR):
-            pReady = round_robin(list_ready);
-            break;
+    // Only schedulers that rank processes by their critical path pay for 
+    // keeping it up to date
+    if (instance.pScheduler->uses_critical_path && critical_path_dirty) {
+        dependencies_update_critical_path();
     }
 
+    // Find valid ready process to run
+    node* pReady = instance.pScheduler->pick_next(list_ready);
+
     // Try to switch the ready and running processes
     if (pReady == NULL) {
         return;
@@ -350,10 +956,14 @@ void switch_process(process_manager manager) {
         pRunningProcess = pReady->data;
         process_run(pRunningProcess);
         list_pop_node(list_ready, pReady);
+        gauges.ready_depth--;
+        process_speculate();
     }
 }
 
 static void allocator_initialise(MEMORY_STRATEGY strategy) {
+    memset(&allocator.stats, 0, sizeof(allocator_stats));
+
     switch(strategy) 
     {
         case(INFINITE):
@@ -373,6 +983,28 @@ static void allocator_initialise(MEMORY_STRATEGY strategy) {
     }
 }
 
+static void allocator_update_stats() {
+    allocator.stats.free_memory = 0;
+    allocator.stats.free_blocks = 0;
+    allocator.stats.largest_free = 0;
+    allocator.stats.fragmentation = 0;
+    if (allocator.strategy == INFINITE) 
+        return;
+
+    for (node* pNode = allocator.free_list->head; pNode != NULL; pNode = pNode->next) {
+        memory_block* pBlock = pNode->data;
+        allocator.stats.free_blocks++;
+        allocator.stats.free_memory += pBlock->size;
+        if (pBlock->size > allocator.stats.largest_free) {
+            allocator.stats.largest_free = pBlock->size;
+        }
+    }
+    if (allocator.stats.free_memory > 0) {
+        allocator.stats.fragmentation = 1.0f - 
+            allocator.stats.largest_free / (float)allocator.stats.free_memory;
+    }
+}
+
 static void allocator_destroy() {
     switch(allocator.strategy) 
     {
@@ -391,12 +1023,16 @@ static void allocater_free_memory(process* pProcess) {
     assert(pProcess != NULL);
 
     // Insert memory block back into the free list
+    allocator.stats.frees++;
+    allocator.stats.in_use -= pProcess->pBlock->size;
+    TRACEPOINT2(free, pProcess->pBlock->index, pProcess->pBlock->size);
     list_insert_sorted(allocator.free_list, pProcess->pBlock, mem_block_cmp);
     pProcess->pBlock = NULL;
 
     // Iterate through list and try to merge adjacent blocks of memory
     node* pNode = allocator.free_list->head;
     while(pNode != NULL ) {
+        COUNTER_ADD(COUNTER_FREE_WALKED, 1);
         if (pNode->next == NULL) break;
         memory_block* pBlock1 = pNode->data;
         memory_block* pBlock2 = pNode->next->data;
@@ -405,6 +1041,8 @@ static void allocater_free_memory(process* pProcess) {
         if (pBlock1->index + pBlock1->size == pBlock2->index) {
             pBlock2->index -= pBlock1->size;
             pBlock2->size += pBlock1->size;
+            allocator.stats.merges++;
+            TRACEPOINT2(merge, pBlock2->index, pBlock2->size);
             pNode = list_pop_node(allocator.free_list, pNode);
             continue;
         }
@@ -413,6 +1051,41 @@ static void allocater_free_memory(process* pProcess) {
     }
 }
 
+uint32_t process_unblocked_memory(process* pProcess) {
+    assert(pProcess != NULL);
+
+    if (allocator.strategy == INFINITE || 
+        pProcess->pBlock == NULL) 
+        return 0;
+
+    // Merge the process' block with adjacent free blocks, and find the 
+    // largest block that is free right now
+    memory_block* pBlock = pProcess->pBlock;
+    uint32_t merged_size = pBlock->size;
+    uint32_t largest_free = 0;
+    for (node* pNode = allocator.free_list->head; pNode != NULL; pNode = pNode->next) {
+        memory_block* pFree = pNode->data;
+        if (pFree->index + pFree->size == pBlock->index || 
+            pBlock->index + pBlock->size == pFree->index) {
+            merged_size += pFree->size;
+        }
+        if (pFree->size > largest_free) {
+            largest_free = pFree->size;
+        }
+    }
+
+    // Sum memory of waiting programs that only the merged block can fit
+    uint32_t gain = 0;
+    for (node* pNode = list_input->head; pNode != NULL; pNode = pNode->next) {
+        program* pProgram = pNode->data;
+        if (pProgram->memory_required > largest_free && 
+            pProgram->memory_required <= merged_size) {
+            gain += pProgram->memory_required;
+        }
+    }
+    return gain;
+}
+
 static memory_block* allocator_find_best_fit(uint32_t size) {
     if (allocator.strategy == INFINITE) 
         return NULL;
@@ -425,6 +1098,7 @@ static memory_block* allocator_find_best_fit(uint32_t size) {
     // Iterate through list and try to find sufficiently
     // size block of memory
     while(pNode != NULL) {
+        COUNTER_ADD(COUNTER_BEST_FIT_INSPECTED, 1);
         memory_block* pBlock = pNode->data;
         if (pBlock->size < size) {
             pNode = pNode->next;
@@ -440,8 +1114,10 @@ static memory_block* allocator_find_best_fit(uint32_t size) {
     }
 
     // No block was found, so we return NULL
-    if (pChosenBlock == NULL) 
+    if (pChosenBlock == NULL) {
+        allocator.stats.failed_allocations++;
         return NULL;
+    }
 
     // Create a memory block to hand over to a process
     memory_block* pAllocation = malloc(sizeof(memory_block));
@@ -452,25 +1128,65 @@ static memory_block* allocator_find_best_fit(uint32_t size) {
     pChosenBlock->index += size;
     pChosenBlock->size -= size;
 
+    allocator.stats.allocations++;
+    allocator.stats.in_use += size;
+    TRACEPOINT2(alloc, size, pAllocation->index);
+    if (allocator.stats.in_use > allocator.stats.peak_in_use) {
+        allocator.stats.peak_in_use = allocator.stats.in_use;
+    }
+
     return pAllocation;
 }
 
 static void process_terminate(process* pProcess) {
     assert(pProcess != NULL);
 
+    // Charge the cost of tearing down the process
+    time += instance.costs.terminate;
+    TRACEPOINT3(terminate, pProcess->pProgram->name, time, 
+        time - pProcess->pProgram->time_arrived);
+    LOG(LOG_INFO, "Terminating %s at %u\n", pProcess->pProgram->name, time);
+
     // Send current time to child process
-    uint32_t be_time = big_endian(time);
-    fd_write(pProcess->P2Cfd[PIPE_WRITE], &be_time, sizeof(uint32_t));
-    kill(pProcess->child_pid, SIGTERM);
+    process_send_time(pProcess, OP_TERM);
+    if (instance.protocol == PROTOCOL_SIGNALS) {
+        kill(pProcess->child_pid, SIGTERM);
+    }
+
+    // Emulated children hash everything but the last 9 bytes of their buffer
+    struct rusage usage = {};
+    if (instance.protocol == PROTOCOL_EMULATED) {
+        sha256_hash(pProcess->emulated_content, sizeof(pProcess->emulated_content) - 9, 
+            pProcess->sha_buf);
+        pProcess->state = FINISHED;
+    } else {
 
-    // Read sha hash value from process
-    fd_read(pProcess->C2Pfd[PIPE_READ], pProcess->sha_buf, SHA_HASH_SIZE);
-    pProcess->sha_buf[SHA_HASH_SIZE] = 0;
+        // Read sha hash value from process
+        process_read(pProcess, pProcess->sha_buf, SHA_HASH_SIZE);
+        pProcess->sha_buf[SHA_HASH_SIZE] = 0;
 
-    // Close remaining pipes
-    close(pProcess->P2Cfd[PIPE_WRITE]);
-    close(pProcess->C2Pfd[PIPE_READ]);
-    pProcess->state = FINISHED;
+        // Close remaining pipes
+        close(pProcess->P2Cfd[PIPE_WRITE]);
+        close(pProcess->C2Pfd[PIPE_READ]);
+        pProcess->state = FINISHED;
+
+        // Reap the child, collecting the real resources it used
+        if (wait4(pProcess->child_pid, NULL, 0, &usage) == -1) {
+            err(EXIT_FAILURE, "wait4");
+        }
+    }
+    double user_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+    double system_seconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    children.service_time += pProcess->pProgram->service_time;
+    children.user_seconds += user_seconds;
+    children.system_seconds += system_seconds;
+    children.voluntary_switches += usage.ru_nvcsw;
+    children.involuntary_switches += usage.ru_nivcsw;
+    if ((uint64_t)usage.ru_maxrss > children.max_rss_kb) {
+        children.max_rss_kb = usage.ru_maxrss;
+    }
+    gauges.live_children--;
+    gauges.finished_count++;
 
     // Do some stat stuff
     uint32_t process_turnaround_time = time - pProcess->pProgram->time_arrived;
@@ -480,26 +1196,106 @@ static void process_terminate(process* pProcess) {
     if (max_overhead == 0 || max_overhead < process_time_overhead) {
         max_overhead = process_time_overhead;
     }
+
+    histogram_record(&turnaround_histogram, process_turnaround_time);
+    histogram_record(&waiting_histogram, 
+        process_turnaround_time - pProcess->run_time - pProcess->blocked_time);
+    histogram_record(&response_histogram, 
+        pProcess->first_run_time - pProcess->pProgram->time_arrived);
+    histogram_record(&overhead_histogram, (uint64_t)roundf(process_time_overhead*100));
+
+    accounting_record record = {
+        .name = pProcess->pProgram->name,
+        .time_arrived = pProcess->pProgram->time_arrived,
+        .admitted_time = pProcess->admitted_time,
+        .first_run_time = pProcess->first_run_time,
+        .suspend_count = pProcess->suspend_count,
+        .block_count = pProcess->block_count,
+        .ready_wait = pProcess->ready_wait,
+        .finish_time = time,
+        .memory_index = pProcess->pBlock != NULL ? (int64_t)pProcess->pBlock->index : -1,
+        .memory_size = pProcess->pProgram->memory_required,
+        .service_time = pProcess->pProgram->service_time,
+        .user_seconds = user_seconds,
+        .system_seconds = system_seconds,
+        .voluntary_switches = usage.ru_nvcsw,
+        .involuntary_switches = usage.ru_nivcsw,
+        .max_rss_kb = usage.ru_maxrss,
+    };
+    accounting_write(&record);
 } 
 
-static void fd_write(int fd, void* pBuf, size_t nbytes) {
+static bool fd_write(int fd, void* pBuf, size_t nbytes) {
     uint8_t* pBuffer = pBuf;
     size_t bytes_remaining = nbytes;
 
+    // A write to a child that exited raises SIGPIPE, which is held back and
+    // discarded so the caller can report the child instead
+    sigset_t pipe_mask, old_mask;
+    sigemptyset(&pipe_mask);
+    sigaddset(&pipe_mask, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_mask, &old_mask);
+
     // Make sure we write N bytes to the given file descriptor
-    while(bytes_remaining > 0) {
+    bool closed = FALSE;
+    while(bytes_remaining > 0 && !closed) {
         ssize_t bytes_written = write(fd, pBuffer, bytes_remaining);
         
-        if(bytes_written == -1) {
+        if (bytes_written == -1 && errno == EPIPE) {
+            struct timespec no_wait = {};
+            sigtimedwait(&pipe_mask, NULL, &no_wait);
+            closed = TRUE;
+        } else if (bytes_written == -1) {
             err(EXIT_FAILURE, "write");
+        } else {
+            bytes_remaining -= bytes_written;
+            pBuffer += bytes_written;
         }
-
-        bytes_remaining -= bytes_written;
-        pBuffer += bytes_written;
     } 
+    pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+    return !closed;
 }
 
-static void fd_read(int fd, void* pBuf, size_t nbytes) {
+static uint8_t process_send_time(process* pProcess, PROTOCOL_OP op) {
+    assert(pProcess != NULL);
+
+    // Opcode and time go out in one write so the child reads whole messages
+    uint8_t message[1 + sizeof(uint32_t)];
+    uint32_t be_time = big_endian(time);
+    bool has_opcode = instance.protocol == PROTOCOL_MESSAGES && op != OP_START;
+    message[0] = op;
+    memcpy(message + 1, &be_time, sizeof(uint32_t));
+
+    // Emulated children store every message, opcode included, the way 
+    // ./process does
+    if (instance.protocol == PROTOCOL_EMULATED) {
+        emulated_store(pProcess, message, sizeof(message));
+        return message[sizeof(message) - 1];
+    }
+    process_write(pProcess, 
+        has_opcode ? message : message + 1, 
+        has_opcode ? sizeof(message) : sizeof(uint32_t));
+    return message[sizeof(message) - 1];
+}
+
+static void process_expect_ack(process* pProcess, uint8_t expected, const char* operation) {
+    assert(pProcess != NULL);
+
+    // Emulated children always acknowledge correctly
+    if (instance.protocol == PROTOCOL_EMULATED) 
+        return;
+
+    uint8_t ack = 0;
+    process_read(pProcess, &ack, sizeof(uint8_t));
+    if (ack != expected) {
+        LOG(LOG_ERROR, "%s sent %u when %s, expected %u\n", 
+            pProcess->pProgram->name, ack, operation, expected);
+        logger_dump();
+        exit(EXIT_FAILURE);
+    }
+}
+
+static bool fd_read(int fd, void* pBuf, size_t nbytes) {
     uint8_t* pBuffer = pBuf;
     size_t bytes_remaining = nbytes;
 
@@ -509,61 +1305,235 @@ static void fd_read(int fd, void* pBuf, size_t nbytes) {
         if (bytes_read == -1) {
             err(EXIT_FAILURE, "read");
         }
+        if (bytes_read == 0) {
+            return FALSE;
+        }
         bytes_remaining -= bytes_read;
         pBuffer += bytes_read;
     }
+    return TRUE;
+}
+
+static void process_write(process* pProcess, void* pBuf, size_t nbytes) {
+    assert(pProcess != NULL);
+
+    if (!fd_write(pProcess->P2Cfd[PIPE_WRITE], pBuf, nbytes)) {
+        process_died(pProcess);
+    }
+}
+
+static void process_read(process* pProcess, void* pBuf, size_t nbytes) {
+    assert(pProcess != NULL);
+
+    if (!fd_read(pProcess->C2Pfd[PIPE_READ], pBuf, nbytes)) {
+        process_died(pProcess);
+    }
+}
+
+static void process_died(process* pProcess) {
+    assert(pProcess != NULL);
+
+    // A child only closes its pipes by exiting, so it is reaped to find out why
+    const char* name = pProcess->pProgram->name;
+    int wstatus = 0;
+    if (waitpid(pProcess->child_pid, &wstatus, 0) == -1) {
+        errx(EXIT_FAILURE, "child process of %s (pid %d) closed its pipes at %u", 
+            name, pProcess->child_pid, time);
+    }
+    if (WIFSIGNALED(wstatus)) {
+        errx(EXIT_FAILURE, "child process of %s (pid %d) was killed by signal %d at %u", 
+            name, pProcess->child_pid, WTERMSIG(wstatus), time);
+    }
+    errx(EXIT_FAILURE, "child process of %s (pid %d) exited with status %d at %u", 
+        name, pProcess->child_pid, WEXITSTATUS(wstatus), time);
+}
+
+static bool process_negotiate(process* pProcess) {
+    assert(pProcess != NULL);
+
+    struct pollfd child = { .fd = pProcess->C2Pfd[PIPE_READ], .events = POLLIN };
+    int ready;
+    do {
+        ready = poll(&child, 1, PROTOCOL_VERSION_TIMEOUT_MS);
+    } while (ready == -1 && errno == EINTR);
+    if (ready == -1) {
+        err(EXIT_FAILURE, "poll");
+    }
+    if (ready == 0)
+        return FALSE;
+
+    // A child that exited instead is reported by the read
+    process_expect_ack(pProcess, PROTOCOL_MESSAGES, "negotiating");
+    return TRUE;
 }
 
 
-static node* shortest_job_first(list* pList) {
-    assert(pList != NULL);
+static void dependencies_add(uint32_t index) {
+    program* pProgram = program_at(&instance, index);
+    pProgram->critical_path = pProgram->service_time;
+
+    if (pProgram->pDependsOn == NULL) 
+        return;
+
+    // Link the program to each of its predecessors
+    char* name = strtok(pProgram->pDependsOn, ",");
+    while(name != NULL) {
+        uint32_t predecessor = name_table_find(name);
+        if (predecessor == instance.program_count) {
+            errx(EXIT_FAILURE, "%s depends on %s, which was not added before it", 
+                pProgram->name, name);
+        }
 
-    node* pNode = pList->head;
-    node* pChosen = NULL;
-    uint32_t min_time = 0;
+        dependency_node* pPredecessor = &pDependencies[predecessor];
+        dependencies_append(&pPredecessor->pSuccessors, &pPredecessor->successor_count, 
+            &pPredecessor->successor_capacity, index);
+
+        // With --pipeline a predecessor may have finished before this program
+        // was parsed, and it will never release it
+        if (!pPredecessor->finished) {
+            pDependencies[index].unfinished_count++;
+        }
+
+        // Predecessors are only walked to update critical paths
+        if (instance.pScheduler->uses_critical_path) {
+            dependency_node* pNode = &pDependencies[index];
+            dependencies_append(&pNode->pPredecessors, &pNode->predecessor_count, 
+                &pNode->predecessor_capacity, predecessor);
+            dependencies_queue_critical_path(predecessor);
+        }
+
+        name = strtok(NULL, ",");
+    }
+
+    FREE(pProgram->pDependsOn);
+}
+
+static void dependencies_append(uint32_t** ppIndices, uint32_t* pCount, 
+    uint32_t* pCapacity, uint32_t index) {
     
-    // Iterate through list and find process that has
-    // the shortest service time
-    while(pNode != NULL) {
-        process* pProcess = pNode->data;
-        uint32_t service_time = pProcess->pProgram->service_time;
+    if (*pCount == *pCapacity) {
+        *pCapacity = *pCapacity == 0 ? 2 : *pCapacity*2;
+        *ppIndices = realloc(*ppIndices, sizeof(uint32_t)*(*pCapacity));
+    }
+    (*ppIndices)[(*pCount)++] = index;
+}
 
-        // Choose first process that appears
-        if (pChosen == NULL) {
-            min_time = service_time;
-            pChosen = pNode;
-            pNode = pNode->next;
-            continue;
+static void dependencies_release(program* pProgram) {
+    assert(pProgram != NULL);
+
+    dependency_node* pNode = &pDependencies[pProgram->index];
+    pNode->finished = TRUE;
+    for (uint32_t i=0; i<pNode->successor_count; i++) {
+        uint32_t successor = pNode->pSuccessors[i];
+        if (--pDependencies[successor].unfinished_count == 0 && 
+            pDependencies[successor].arrived) {
+            list_insert_tail(list_input, program_at(&instance, successor));
+            gauges.input_depth++;
         }
+    }
+}
 
-        process* pChosenProcess = pChosen->data;
+static void dependencies_update_critical_path() {
 
-        // Otherwise compare and assign accordingly
-        if (min_time == service_time) {
-            if (pChosenProcess->pProgram->time_arrived == pProcess->pProgram->time_arrived) {
-                if(strcmp(pChosenProcess->pProgram->name, pProcess->pProgram->name) > 0) {
-                    pChosen = pNode;
-                    min_time = service_time;
-                }
-            } else if (pChosenProcess->pProgram->time_arrived > pProcess->pProgram->time_arrived) {
-                pChosen = pNode;
-                min_time = service_time;    
+    // Successors always have larger indices than their predecessors, so
+    // popping the largest index first visits successors first
+    program* pProgram;
+    while ((pProgram = priority_queue_pop(queue_critical)) != NULL) {
+        dependency_node* pNode = &pDependencies[pProgram->index];
+        pNode->queued = FALSE;
+        uint64_t longest = 0;
+        for (uint32_t j=0; j<pNode->successor_count; j++) {
+            uint64_t path = program_at(&instance, pNode->pSuccessors[j])->critical_path;
+            if (path > longest) {
+                longest = path;
             }
         }
-        else if (min_time > service_time) {
-            pChosen = pNode;
-            min_time = service_time;
+        if (pProgram->service_time + longest == pProgram->critical_path) 
+            continue;
+
+        pProgram->critical_path = pProgram->service_time + longest;
+        for (uint32_t j=0; j<pNode->predecessor_count; j++) {
+            dependencies_queue_critical_path(pNode->pPredecessors[j]);
         }
+    }
+    critical_path_dirty = FALSE;
+}
 
-        pNode = pNode->next;
+static void dependencies_queue_critical_path(uint32_t index) {
+    dependency_node* pNode = &pDependencies[index];
+    if (pNode->queued || pNode->finished) 
+        return;
+
+    pNode->queued = TRUE;
+    priority_queue_push(queue_critical, program_at(&instance, index));
+    critical_path_dirty = TRUE;
+}
+
+static char* burst_parse(char* field, uint32_t* pLength) {
+    assert(field != NULL);
+    assert(pLength != NULL);
+
+    // strtoul() would skip whitespace and accept signs, which are not lengths
+    if (!isdigit((unsigned char)*field))
+        return NULL;
+
+    char* end = NULL;
+    errno = 0;
+    unsigned long length = strtoul(field, &end, 10);
+    if (errno == ERANGE || length > UINT32_MAX)
+        return NULL;
+
+    *pLength = length;
+    return end;
+}
+
+static uint32_t name_hash(const char* name) {
+
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (; *name != '\0'; name++) {
+        hash ^= (uint8_t)*name;
+        hash *= 16777619u;
     }
+    return hash;
+}
+
+static uint32_t name_table_find(const char* name) {
+    if (name_table_capacity == 0) 
+        return instance.program_count;
 
-    return pChosen;
+    uint32_t slot = name_hash(name) & (name_table_capacity - 1);
+    while(pNameTable[slot] != 0) {
+        uint32_t index = pNameTable[slot] - 1;
+        if (strcmp(program_at(&instance, index)->name, name) == 0) 
+            return index;
+        slot = (slot + 1) & (name_table_capacity - 1);
+    }
+    return instance.program_count;
 }
 
-static node* round_robin(list* pList) {
-    assert(pList != NULL);
-    return pList->head;
+static void name_table_insert(uint32_t index) {
+
+    // Keep the table at most half full, rehashing every program on growth
+    if (2*instance.program_count > name_table_capacity) {
+        name_table_capacity = name_table_capacity == 0 ? 16 : name_table_capacity*2;
+        FREE(pNameTable);
+        pNameTable = calloc(name_table_capacity, sizeof(uint32_t));
+        for (uint32_t i=0; i<index; i++) {
+            name_table_insert(i);
+        }
+    }
+
+    uint32_t slot = name_hash(program_at(&instance, index)->name) & (name_table_capacity - 1);
+    while(pNameTable[slot] != 0) {
+
+        // Later programs shadow earlier programs with the same name
+        if (strcmp(program_at(&instance, pNameTable[slot] - 1)->name, 
+                   program_at(&instance, index)->name) == 0) 
+            break;
+        slot = (slot + 1) & (name_table_capacity - 1);
+    }
+    pNameTable[slot] = index + 1;
 }
 
 uint32_t big_endian(uint32_t integer) {
@@ -584,17 +1554,57 @@ static void process_run(process* pProcess) {
     assert(pProcess != NULL);
 
     pProcess->state = RUNNING;
+    pProcess->ready_wait += time - pProcess->ready_since;
+
+    // Charge the cost of resuming or spawning the process. Speculative 
+    // children are charged as spawns, so simulated time does not change.
+    bool resuming = pProcess->child_pid != PID_NULL_HANDLE && !pProcess->speculative;
+    if (resuming) {
+        time += instance.costs.resume;
+    } else {
+        time += instance.costs.spawn;
+        pProcess->first_run_time = time;
+    }
     process_log(pProcess);
 
     // Processes that are suspended should resume
-    if (pProcess->child_pid != PID_NULL_HANDLE) {
+    if (resuming) {
         process_continue(pProcess);
         return;
     } 
 
-    // Set up pipes between parent and child process 
-    pipe(pProcess->P2Cfd);
-    pipe(pProcess->C2Pfd);
+    TRACEPOINT3(run, pProcess->pProgram->name, time, 
+        pProcess->pProgram->service_time - pProcess->run_time);
+    LOG(LOG_INFO, "Spawning %s at %u\n", pProcess->pProgram->name, time);
+
+    if (pProcess->child_pid == PID_NULL_HANDLE) {
+        process_spawn(pProcess);
+    }
+    process_start(pProcess);
+}
+
+static void process_spawn(process* pProcess) {
+    assert(pProcess != NULL);
+    assert(pProcess->child_pid == PID_NULL_HANDLE);
+
+    // Emulated children start by storing their name
+    gauges.live_children++;
+    if (instance.protocol == PROTOCOL_EMULATED) {
+        pProcess->child_pid = PID_EMULATED_HANDLE;
+        memset(pProcess->emulated_content, 0, sizeof(pProcess->emulated_content));
+        pProcess->emulated_index = 0;
+        emulated_store(pProcess, pProcess->pProgram->name, strlen(pProcess->pProgram->name));
+        return;
+    }
+
+    // Set up pipes between parent and child process. Other threads may fork 
+    // at the same time, so the pipes are closed on exec in their children 
+    if (pipe2(pProcess->P2Cfd, O_CLOEXEC) == -1 || pipe2(pProcess->C2Pfd, O_CLOEXEC) == -1) {
+        err(EXIT_FAILURE, "pipe2");
+    }
+
+    // Choose the child's CPU before forking so spread placement advances
+    child_cpu = affinity_next_child_cpu();
 
     if ((pProcess->child_pid = fork()) == -1) {
         perror("fork");
@@ -613,8 +1623,20 @@ static void process_run(process* pProcess) {
         dup2(pProcess->P2Cfd[PIPE_READ], STDIN_FILENO);
         dup2(pProcess->C2Pfd[PIPE_WRITE], STDOUT_FILENO);
 
+        // Pin before exec so the child never runs anywhere else
+        if (child_cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(child_cpu, &set);
+            sched_setaffinity(0, sizeof(cpu_set_t), &set);
+        }
+
         // Start execution of child process
-        execl("./process", "process", pProcess->pProgram->name, (char*)NULL);
+        if (instance.protocol == PROTOCOL_MESSAGES) {
+            execl("./process", "process", "--protocol=2", pProcess->pProgram->name, (char*)NULL);
+        } else {
+            execl("./process", "process", pProcess->pProgram->name, (char*)NULL);
+        }
 
         // execl() should not return anything, so we print an error message
         // and exit the program
@@ -628,38 +1650,111 @@ static void process_run(process* pProcess) {
         // Close unused ends of pipes
         close(pProcess->P2Cfd[PIPE_READ]);
         close(pProcess->C2Pfd[PIPE_WRITE]);
+    }   
+}
 
-        // Send current time to child process
-        uint32_t be_time = big_endian(time);
-        uint8_t last_byte_sent = ((uint8_t*)&be_time)[3];
-        fd_write(pProcess->P2Cfd[PIPE_WRITE], &be_time, sizeof(uint32_t));
+static void process_start(process* pProcess) {
+    assert(pProcess != NULL);
 
-        // Verify information was sent properly
-        uint8_t verify_byte = 0;
-        fd_read(pProcess->C2Pfd[PIPE_READ], &verify_byte, sizeof(uint8_t));
-        if (verify_byte != last_byte_sent) {
-            exit(EXIT_FAILURE);
+    if (pProcess->speculative) {
+        pProcess->speculative = FALSE;
+        speculative_hits++;
+        if (pSpeculative == pProcess) {
+            pSpeculative = NULL;
         }
-    }   
+    }
+
+    // Send current time to child process, and verify it was sent properly
+    uint8_t last_byte_sent = process_send_time(pProcess, OP_START);
+    process_expect_ack(pProcess, last_byte_sent, "starting");
+
+    // Children that speak version 2 follow with their version. Every child
+    // runs the same ./process, so once one only speaks version 1 the rest of
+    // the run uses version 1, starting with this child.
+    if (instance.protocol == PROTOCOL_MESSAGES && !process_negotiate(pProcess)) {
+        warnx("%s sent no protocol version, falling back to version 1", 
+            pProcess->pProgram->name);
+        instance.protocol = PROTOCOL_SIGNALS;
+    }
+}
+
+static void emulated_store(process* pProcess, const void* pBuf, size_t nbytes) {
+    assert(pProcess != NULL);
+
+    // The index advances by the position in the buffer, not by one
+    const uint8_t* pBytes = pBuf;
+    size_t size = sizeof(pProcess->emulated_content) - 9;
+    for (size_t i=0; i<nbytes; i++) {
+        pProcess->emulated_index = (pProcess->emulated_index + i) % size;
+        pProcess->emulated_content[pProcess->emulated_index] ^= pBytes[i];
+    }
+}
+
+static void process_speculate() {
+    if (!instance.speculate || 
+        pSpeculative != NULL || 
+        list_ready->head == NULL) 
+        return;
+
+    // Non-preemptive schedulers only dispatch once the running process 
+    // finishes its CPU burst, so wait until that is within one quantum
+    if (pRunningProcess != NULL && 
+        instance.pScheduler->should_preempt == NULL && 
+        pRunningProcess->burst_end - pRunningProcess->run_time > last_quantum) 
+        return;
+
+    if (instance.pScheduler->uses_critical_path && critical_path_dirty) {
+        dependencies_update_critical_path();
+    }
+
+    // A prediction is not a decision, so the work the scheduler does for it
+    // is left out of the counters
+    uint64_t counted[COUNTER_COUNT];
+    memcpy(counted, counter_ticks, sizeof(counted));
+    node* pNext = instance.pScheduler->pick_next(list_ready);
+    memcpy(counter_ticks, counted, sizeof(counted));
+    if (pNext == NULL) 
+        return;
+
+    process* pProcess = pNext->data;
+    if (pProcess->child_pid != PID_NULL_HANDLE) 
+        return;
+
+    LOG(LOG_DEBUG, "Speculatively spawning %s at %u\n", pProcess->pProgram->name, time);
+    process_spawn(pProcess);
+    pProcess->speculative = TRUE;
+    pSpeculative = pProcess;
+    speculative_spawns++;
 }
 
 static void process_suspend(process* pProcess) {
     assert(pProcess != NULL);
 
-    int wstatus;
-    pid_t w;
+    LOG(LOG_INFO, "Suspending execution of %s at %u\n", pProcess->pProgram->name, time);
 
-    debug_log("Suspending execution of %s\n", pProcess->pProgram->name);
+    // Charge the cost of stopping the process
+    time += instance.costs.suspend;
+    TRACEPOINT3(suspend, pProcess->pProgram->name, time, 
+        pProcess->pProgram->service_time - pProcess->run_time);
 
     // Send current time to child process
-    uint32_t be_time = big_endian(time);
-    fd_write(pProcess->P2Cfd[PIPE_WRITE], &be_time, sizeof(uint32_t));
+    double round_trip_start = wall_time();
+    uint8_t last_byte_sent = process_send_time(pProcess, OP_STOP);
+
+    // Version 2 and emulated children acknowledge and wait for the next message
+    if (instance.protocol != PROTOCOL_SIGNALS) {
+        process_expect_ack(pProcess, last_byte_sent, "stopping");
+        histogram_record(&round_trip_histogram, (uint64_t)((wall_time() - round_trip_start)*1e9));
+        return;
+    }
 
     // Signal child process to suspend execution
     kill(pProcess->child_pid, SIGTSTP);
 
     // Wait for process to stop execution
     // Ref: https://man7.org/linux/man-pages/man2/wait.2.html
+    int wstatus;
+    pid_t w;
     do {
         w = waitpid(pProcess->child_pid, &wstatus, WUNTRACED);
 
@@ -669,38 +1764,39 @@ static void process_suspend(process* pProcess) {
         }
 
         if (WIFSTOPPED(wstatus)) {
-           debug_log("stopped by signal %d\n", WSTOPSIG(wstatus));
+            LOG(LOG_DEBUG, "stopped by signal %d\n", WSTOPSIG(wstatus));
             break;
         }
     }   while(!WIFEXITED(wstatus) && !WIFSIGNALED(wstatus));
+    histogram_record(&round_trip_histogram, (uint64_t)((wall_time() - round_trip_start)*1e9));
 }
 
 static void process_continue(process* pProcess) {
     assert(pProcess != NULL);
 
-    debug_log("Continuing execution of %s\n", pProcess->pProgram->name);
+    LOG(LOG_INFO, "Continuing execution of %s at %u\n", pProcess->pProgram->name, time);
+    TRACEPOINT3(continue, pProcess->pProgram->name, time, 
+        pProcess->pProgram->service_time - pProcess->run_time);
 
     // Send current time to child process
-    uint32_t be_time = big_endian(time);
-    uint8_t last_byte_sent = ((uint8_t*)&be_time)[3];
-    fd_write(pProcess->P2Cfd[PIPE_WRITE], &be_time, sizeof(uint32_t));
+    double round_trip_start = wall_time();
+    uint8_t last_byte_sent = process_send_time(pProcess, OP_CONTINUE);
 
     // Signal child process to continue execution
-    kill(pProcess->child_pid, SIGCONT);
+    if (instance.protocol == PROTOCOL_SIGNALS) {
+        kill(pProcess->child_pid, SIGCONT);
+    }
 
     // Verify information was properly sent
-    uint8_t verify_byte = 0;
-    fd_read(pProcess->C2Pfd[PIPE_READ], &verify_byte, sizeof(uint8_t));
-    if (verify_byte != last_byte_sent) {
-        exit(EXIT_FAILURE);
-    }
+    process_expect_ack(pProcess, last_byte_sent, "continuing");
+    histogram_record(&round_trip_histogram, (uint64_t)((wall_time() - round_trip_start)*1e9));
 }
 
 bool should_terminate(process_manager manager) {
     assert(initialised);
     assert(manager == &instance);
 
-    debug_log("%d, LOOP START\n", time);
+    LOG(LOG_DEBUG, "%d, LOOP START\n", time);
 
     // If the process manager has 0 added programs we stop 
     // program execution
@@ -715,6 +1811,7 @@ bool should_terminate(process_manager manager) {
     // and are finished
     node* pNode = list_active->head;
     while(pNode != NULL) {
+        COUNTER_ADD(COUNTER_TERMINATE_WALKED, 1);
         process* pProcess = pNode->data;
         if (pProcess->state != FINISHED) {
             finished = FALSE;
@@ -729,59 +1826,117 @@ bool should_terminate(process_manager manager) {
 static process* process_try_create(program* pProgram) {
     assert(pProgram != NULL);
 
-    debug_log("Attempting to create %s \n", pProgram->name);
+    LOG(LOG_DEBUG, "Attempting to create %s \n", pProgram->name);
 
     // Try to allocate a block of memory for the program
     memory_block* pBlock = NULL;
     if (allocator.strategy == BEST_FIT) {
         if ((pBlock = allocator_find_best_fit(pProgram->memory_required)) == NULL) {
-            debug_log("Allocation for %s unsuccessful\n", pProgram->name);
+            LOG(LOG_DEBUG, "Allocation for %s unsuccessful\n", pProgram->name);
             return NULL;
         }
     }
 
-    debug_log("Allocation for %s successful\n", pProgram->name);
+    LOG(LOG_DEBUG, "Allocation for %s successful\n", pProgram->name);
 
     // Create process and give it to the process manager
     process* pProcess = malloc(sizeof(process));
     pProcess->pProgram = pProgram;
     pProcess->child_pid = PID_NULL_HANDLE;
+    pProcess->speculative = FALSE;
     pProcess->pBlock = pBlock;
     pProcess->run_time = 0;
+    pProcess->burst_index = 0;
+    pProcess->burst_end = pProgram->pBursts != NULL ? 
+        pProgram->pBursts[0] : pProgram->service_time;
+    pProcess->wake_time = 0;
+    pProcess->first_run_time = 0;
+    pProcess->blocked_time = 0;
+    pProcess->admitted_time = time;
+    pProcess->ready_since = time;
+    pProcess->ready_wait = 0;
+    pProcess->suspend_count = 0;
+    pProcess->block_count = 0;
+    TRACEPOINT4(admit, pProgram->name, time, 
+        pBlock != NULL ? pBlock->index : -1, pProgram->memory_required);
     return pProcess;
 }
 
+static void process_block(process* pProcess, uint32_t block_time) {
+    assert(pProcess != NULL);
+    assert(pProcess->pProgram->pBursts != NULL);
+
+    LOG(LOG_INFO, "Blocking %s on I/O at %u\n", pProcess->pProgram->name, time);
+
+    // Stop the child process for the duration of the I/O burst, which is not
+    // a preemption, so it is counted apart from suspensions
+    pProcess->block_count++;
+    process_suspend(pProcess);
+
+    // Move on to the next CPU burst, which follows the I/O burst and is
+    // measured from where the process stopped rather than the quantum
+    uint32_t* pBursts = pProcess->pProgram->pBursts;
+    pProcess->wake_time = block_time + pBursts[pProcess->burst_index + 1];
+    pProcess->blocked_time -= block_time; // Completed when the process wakes
+    pProcess->burst_index += 2;
+    pProcess->burst_end = pProcess->run_time + pBursts[pProcess->burst_index];
+    pProcess->state = BLOCKED;
+    priority_queue_push(queue_blocked, pProcess);
+    process_log(pProcess);
+}
+
+static void process_wake_blocked() {
+    process* pProcess = priority_queue_peek(queue_blocked);
+    while(pProcess != NULL && pProcess->wake_time <= time) {
+        priority_queue_pop(queue_blocked);
+        pProcess->blocked_time += time;
+        process_submit_ready(pProcess);
+        pProcess = priority_queue_peek(queue_blocked);
+    }
+}
+
 static void process_submit_ready(process* pProcess) {
     pProcess->state = READY;
+    pProcess->ready_since = time;
     list_insert_tail(list_ready, pProcess);
+    gauges.ready_depth++;
+    if (instance.pScheduler->on_ready != NULL) {
+        instance.pScheduler->on_ready(pProcess);
+    }
 }
 
 static void process_log(process* pProcess) {
+    gauges.event_count++;
+
+    run_event event = {};
+    event.time = time;
+    snprintf(event.name, sizeof(event.name), "%s", pProcess->pProgram->name);
     switch(pProcess->state) 
     {
         case(READY):
-            printf("%d,READY,process_name=%s,assigned_at=%d\n",
-            time,
-            pProcess->pProgram->name,
-            pProcess->pBlock->index);
+            event.type = EVENT_READY;
+            event.value = pProcess->pBlock->index;
             break;
         case(RUNNING):
-            printf("%d,RUNNING,process_name=%s,remaining_time=%d\n",
-            time,
-            pProcess->pProgram->name,
-            pProcess->pProgram->service_time - pProcess->run_time);
+            event.type = EVENT_RUNNING;
+            event.value = pProcess->pProgram->service_time - pProcess->run_time;
+            break;
+        case(BLOCKED):
+            event.type = EVENT_BLOCKED;
+            event.value = pProcess->wake_time;
             break;
         case(FINISHED):
-            printf("%d,FINISHED,process_name=%s,proc_remaining=%d\n",
-            time,
-            pProcess->pProgram->name,
-            instance.pending_count);
-            printf("%d,FINISHED-PROCESS,process_name=%s,sha=%s\n",
-            time,
-            pProcess->pProgram->name,
-            pProcess->sha_buf);
+            event.type = EVENT_FINISHED;
+            event.value = instance.pending_count;
+            memcpy(event.sha, pProcess->sha_buf, sizeof(event.sha));
             break;
     }
+
+    if (instance.sink != NULL) {
+        instance.sink(&event, instance.pSinkContext);
+    } else if (instance.pOutput != NULL) {
+        event_print(instance.pOutput, &event);
+    }
 }
 
 static int32_t mem_block_cmp(void* pData1, void* pData2) {
@@ -794,14 +1949,210 @@ static int32_t mem_block_cmp(void* pData1, void* pData2) {
     return -1;
 }
 
+static int32_t wake_time_cmp(void* pData1, void* pData2) {
+    process* pProcess1 = pData1;
+    process* pProcess2 = pData2;
+    if (pProcess1->wake_time != pProcess2->wake_time) 
+        return pProcess1->wake_time < pProcess2->wake_time ? -1 : 1;
+    if (pProcess1->pProgram->time_arrived != pProcess2->pProgram->time_arrived)
+        return pProcess1->pProgram->time_arrived < pProcess2->pProgram->time_arrived ? -1 : 1;
+    return strcmp(pProcess1->pProgram->name, pProcess2->pProgram->name);
+}
+
+static int32_t program_index_cmp(void* pData1, void* pData2) {
+    program* pProgram1 = pData1;
+    program* pProgram2 = pData2;
+    return pProgram1->index > pProgram2->index ? -1 : 1;
+}
+
 static void print_final_stats() {
-    turnaround_time /= (float)instance.program_count;
-    turnaround_time = ceilf(turnaround_time);
-    avg_overhead /= (float)instance.program_count;
+    if (instance.pOutput == NULL) 
+        return;
+
+    run_stats stats;
+    process_manager_get_stats(&instance, &stats);
     
-    printf("Turnaround time %u\n", (uint32_t)turnaround_time);
-    printf("Time overhead %.2f %.2f\n", max_overhead, avg_overhead);
-    printf("Makespan %u\n", time);
+    fprintf(instance.pOutput, "Turnaround time %u\n", stats.turnaround_time);
+    fprintf(instance.pOutput, "Time overhead %.2f %.2f\n", stats.max_overhead, stats.avg_overhead);
+    fprintf(instance.pOutput, "Makespan %u\n", stats.makespan);
+
+    // Utilisation is only interesting when the CPU can idle on I/O
+    if (has_io) {
+        fprintf(instance.pOutput, "CPU utilisation %.2f%%\n", 100.0f*stats.cpu_utilisation);
+    }
+
+    // Gap is how far the run is from its lower bound, as a percentage
+    if (instance.report_flags & REPORT_BOUNDS) {
+        fprintf(instance.pOutput, "Turnaround time bound %u gap %.2f%%\n", 
+            stats.turnaround_bound,
+            stats.turnaround_bound > 0 ? 
+                100.0f*(stats.turnaround_time - (float)stats.turnaround_bound) / stats.turnaround_bound : 0.0f);
+        fprintf(instance.pOutput, "Makespan bound %u gap %.2f%%\n", 
+            stats.makespan_bound,
+            stats.makespan_bound > 0 ? 
+                100.0f*(stats.makespan - (float)stats.makespan_bound) / stats.makespan_bound : 0.0f);
+    }
+
+    // Speculation leaves the output unchanged, so its effect goes to stderr
+    if (instance.speculate) {
+        fprintf(stderr, "Speculative spawns %u hits %u\n", speculative_spawns, speculative_hits);
+    }
+
+    if (instance.report_flags & REPORT_ROUND_TRIP) {
+        static const char* placement_names[] = CHILD_PLACEMENT_NAMES;
+        fprintf(instance.pOutput, "Round-trip placement manager %d children %s\n", 
+            instance.affinity.manager_cpu, 
+            placement_names[instance.affinity.placement]);
+        print_percentiles("Round-trip us", &round_trip_histogram, 1000, 1);
+    }
+
+    if (instance.report_flags & REPORT_PERCENTILES) {
+        print_percentiles("Turnaround time", &turnaround_histogram, 1, 0);
+        print_percentiles("Waiting time", &waiting_histogram, 1, 0);
+        print_percentiles("Response time", &response_histogram, 1, 0);
+        print_percentiles("Time overhead", &overhead_histogram, 100, 2);
+    }
+}
+
+static int32_t affinity_next_child_cpu() {
+    static THREAD_LOCAL uint32_t spread_index = 0;
+    if (instance.affinity.placement == PLACE_ANY) 
+        return -1;
+
+    int32_t manager_cpu = instance.affinity.manager_cpu >= 0 ? 
+        instance.affinity.manager_cpu : sched_getcpu();
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == -1 || manager_cpu < 0) 
+        return -1;
+
+    switch(instance.affinity.placement) 
+    {
+        case(PLACE_SIBLING): {
+            // Siblings share a core, so read the core's CPU list from sysfs
+            // and take the first CPU that is not the manager's
+            char path[128];
+            snprintf(path, sizeof(path), 
+                "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", manager_cpu);
+            FILE* fp = fopen(path, "r");
+            int32_t sibling = -1;
+            if (fp != NULL) {
+                int32_t cpu;
+                while (fscanf(fp, "%d", &cpu) == 1) {
+                    if (cpu != manager_cpu) {
+                        sibling = cpu;
+                        break;
+                    }
+                    fgetc(fp); // Skip ',' or '-'
+                }
+                fclose(fp);
+            }
+            return sibling >= 0 ? sibling : manager_cpu;
+        }
+        case(PLACE_SPREAD): {
+            // Walk the CPUs the manager may run on, one per child
+            int32_t count = CPU_COUNT(&allowed);
+            int32_t target = spread_index++ % count;
+            for (int32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &allowed) && target-- == 0) 
+                    return cpu;
+            }
+            return manager_cpu;
+        }
+        default:
+            return manager_cpu;
+    }
+}
+
+typedef struct bound_job {
+    uint32_t arrival;
+    uint64_t remaining;
+} bound_job;
+
+static int bound_job_arrival_cmp(const void* pA, const void* pB) {
+    const bound_job* pJobA = pA;
+    const bound_job* pJobB = pB;
+    return (pJobA->arrival > pJobB->arrival) - (pJobA->arrival < pJobB->arrival);
+}
+
+static int32_t bound_job_remaining_cmp(void* pA, void* pB) {
+    bound_job* pJobA = pA;
+    bound_job* pJobB = pB;
+    return (pJobA->remaining > pJobB->remaining) - (pJobA->remaining < pJobB->remaining);
+}
+
+static void compute_lower_bounds() {
+    if (!bounds_dirty) 
+        return;
+    bounds_dirty = FALSE;
+    turnaround_bound = 0;
+    makespan_bound = 0;
+    if (instance.program_count == 0) 
+        return;
+
+    // Each program must at least finish every CPU and I/O burst after arriving
+    uint64_t makespan = 0;
+    bound_job* pJobs = malloc(sizeof(bound_job)*instance.program_count);
+    for (uint32_t i = 0; i < instance.program_count; i++) {
+        program* pProgram = program_at(&instance, i);
+        uint64_t burst_total = pProgram->service_time;
+        for (uint32_t burst = 1; burst < pProgram->burst_count; burst += 2) {
+            burst_total += pProgram->pBursts[burst];
+        }
+        if (pProgram->time_arrived + burst_total > makespan) {
+            makespan = pProgram->time_arrived + burst_total;
+        }
+        pJobs[i].arrival = pProgram->time_arrived;
+        pJobs[i].remaining = pProgram->service_time;
+    }
+    qsort(pJobs, instance.program_count, sizeof(bound_job), bound_job_arrival_cmp);
+
+    // The CPU can do no better than run every CPU burst back to back
+    uint64_t cpu_time = 0;
+    for (uint32_t i = 0; i < instance.program_count; i++) {
+        cpu_time = (cpu_time > pJobs[i].arrival ? cpu_time : pJobs[i].arrival) + pJobs[i].remaining;
+    }
+    makespan_bound = cpu_time > makespan ? cpu_time : makespan;
+
+    // Preemptive SRPT minimises mean turnaround on one CPU, so simulate it 
+    // event by event, only stopping at arrivals and completions
+    priority_queue* pQueue = priority_queue_create(bound_job_remaining_cmp);
+    uint64_t now = 0;
+    uint64_t turnaround_total = 0;
+    uint32_t next = 0;
+    while (next < instance.program_count || priority_queue_peek(pQueue) != NULL) {
+        if (priority_queue_peek(pQueue) == NULL && pJobs[next].arrival > now) {
+            now = pJobs[next].arrival;
+        }
+        while (next < instance.program_count && pJobs[next].arrival <= now) {
+            priority_queue_push(pQueue, &pJobs[next++]);
+        }
+
+        bound_job* pJob = priority_queue_pop(pQueue);
+        uint64_t next_arrival = next < instance.program_count ? pJobs[next].arrival : UINT64_MAX;
+        if (now + pJob->remaining <= next_arrival) {
+            now += pJob->remaining;
+            turnaround_total += now - pJob->arrival;
+        } else {
+            pJob->remaining -= next_arrival - now;
+            now = next_arrival;
+            priority_queue_push(pQueue, pJob);
+        }
+    }
+    priority_queue_destroy(&pQueue);
+    FREE(pJobs);
+
+    turnaround_bound = (uint32_t)ceil(turnaround_total / (double)instance.program_count);
+}
+
+static void print_percentiles(const char* name, histogram* pHistogram, float scale, int32_t precision) {
+    fprintf(instance.pOutput, "%s p50 %.*f p90 %.*f p99 %.*f p99.9 %.*f max %.*f\n",
+        name,
+        precision, histogram_percentile(pHistogram, 50)/scale,
+        precision, histogram_percentile(pHistogram, 90)/scale,
+        precision, histogram_percentile(pHistogram, 99)/scale,
+        precision, histogram_percentile(pHistogram, 99.9)/scale,
+        precision, pHistogram->max/scale);
 }
 
 void debug_print_program(program* pProgram) {
@@ -827,7 +2178,7 @@ void debug_print_programs(process_manager manager) {
     debug_log(" HANDLE: %p\n", &instance);
     debug_log(" PROCESS COUNT: %d\n", instance.program_count);
     for (uint32_t i=0; i<instance.program_count; i++) {
-        debug_print_program(&instance.pPrograms[i]);
+        debug_print_program(program_at(&instance, i));
     }
     debug_log(LINE);
-}
\ No newline at end of file
+}
@@ -0,0 +1,65 @@
+#include <progress.h>
+#include <report.h>
+#include <sys/time.h>
+
+volatile sig_atomic_t progress_due = FALSE;
+
+static double last_report_time = 0;
+static uint64_t last_tick_count = 0;
+static uint64_t last_event_count = 0;
+
+static void progress_signal_handler(int signal) {
+    progress_due = TRUE;
+}
+
+void progress_start(double interval) {
+    assert(interval > 0);
+
+    // Restart interrupted pipe reads and writes instead of failing them
+    struct sigaction action = {};
+    action.sa_handler = progress_signal_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGALRM, &action, NULL) == -1) {
+        err(EXIT_FAILURE, "sigaction");
+    }
+
+    struct itimerval timer = {};
+    timer.it_interval.tv_sec = (time_t)interval;
+    timer.it_interval.tv_usec = (suseconds_t)((interval - (time_t)interval)*1e6);
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_REAL, &timer, NULL) == -1) {
+        err(EXIT_FAILURE, "setitimer");
+    }
+    last_report_time = wall_time();
+}
+
+void progress_report(process_manager manager) {
+    progress_due = FALSE;
+
+    run_gauges gauges;
+    process_manager_get_gauges(manager, &gauges);
+
+    double now = wall_time();
+    double elapsed = now - last_report_time;
+    fprintf(stderr, "[progress] time=%u admitted=%u/%u finished=%u/%u ready=%u input=%u "
+        "blocked=%u children=%u ticks/s=%.0f events/s=%.0f\n",
+        gauges.time,
+        gauges.admitted_count, gauges.program_count,
+        gauges.finished_count, gauges.program_count,
+        gauges.ready_depth,
+        gauges.input_depth,
+        gauges.blocked_depth,
+        gauges.live_children,
+        (gauges.tick_count - last_tick_count) / elapsed,
+        (gauges.event_count - last_event_count) / elapsed);
+
+    last_report_time = now;
+    last_tick_count = gauges.tick_count;
+    last_event_count = gauges.event_count;
+}
+
+void progress_stop() {
+    struct itimerval timer = {};
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
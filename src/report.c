@@ -0,0 +1,217 @@
+#include <report.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/**
+ * @brief
+ * Writes percentiles, mean and count of a histogram as a JSON object.
+ * @param fp file to write to
+ * @param name key of the object
+ * @param pHistogram pointer to histogram
+ * @param scale amount recorded values were multiplied by
+*/
+static void write_histogram(FILE* fp, const char* name, histogram* pHistogram, double scale);
+
+/**
+ * @brief
+ * Writes a JSON string, escaping quotes, backslashes and control characters.
+ * @param fp file to write to
+ * @param string null-terminated string
+*/
+static void write_string(FILE* fp, const char* string);
+
+/**
+ * @brief
+ * Writes resource usage as a JSON object.
+ * @param fp file to write to
+ * @param name key of the object
+ * @param pUsage pointer to resource usage
+*/
+static void write_rusage(FILE* fp, const char* name, struct rusage* pUsage);
+
+uint64_t fingerprint_update(uint64_t hash, const void* pData, size_t nbytes) {
+    const uint8_t* pBytes = pData;
+    for (size_t i=0; i<nbytes; i++) {
+        hash ^= pBytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+double wall_time() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+void report_set_stats(report* pReport, run_stats* pStats) {
+    assert(pReport != NULL);
+    assert(pStats != NULL);
+
+    pReport->stats = *pStats;
+    pReport->histograms[0] = *pStats->pTurnaround;
+    pReport->histograms[1] = *pStats->pWaiting;
+    pReport->histograms[2] = *pStats->pResponse;
+    pReport->histograms[3] = *pStats->pOverhead;
+    pReport->histograms[4] = *pStats->pRoundTrip;
+    pReport->stats.pTurnaround = &pReport->histograms[0];
+    pReport->stats.pWaiting = &pReport->histograms[1];
+    pReport->stats.pResponse = &pReport->histograms[2];
+    pReport->stats.pOverhead = &pReport->histograms[3];
+    pReport->stats.pRoundTrip = &pReport->histograms[4];
+}
+
+void report_write(const char* path, report* pReport) {
+    assert(path != NULL);
+    assert(pReport != NULL);
+
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL) {
+        err(EXIT_FAILURE, "%s", path);
+    }
+    report_print(fp, pReport);
+    fclose(fp);
+}
+
+void report_print(FILE* fp, report* pReport) {
+    assert(fp != NULL);
+    assert(pReport != NULL);
+
+    run_stats* pStats = &pReport->stats;
+    allocator_stats* pAllocator = &pStats->allocator;
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"config\": {\n");
+    fprintf(fp, "    \"file\": ");
+    write_string(fp, pReport->filename);
+    fprintf(fp, ",\n    \"scheduler\": ");
+    write_string(fp, pReport->scheduler_name);
+    fprintf(fp, ",\n");
+    fprintf(fp, "    \"memory\": \"%s\",\n", 
+        pReport->memory_strategy == INFINITE ? "infinite" : "best-fit");
+    fprintf(fp, "    \"quantum\": %u,\n", pReport->quantum);
+    fprintf(fp, "    \"costs\": {\"spawn\": %u, \"resume\": %u, \"suspend\": %u, \"terminate\": %u},\n",
+        pReport->costs.spawn, 
+        pReport->costs.resume, 
+        pReport->costs.suspend, 
+        pReport->costs.terminate);
+    static const char* placement_names[] = CHILD_PLACEMENT_NAMES;
+    fprintf(fp, "    \"affinity\": {\"manager_cpu\": %d, \"children\": \"%s\"}\n",
+        pReport->affinity.manager_cpu,
+        placement_names[pReport->affinity.placement]);
+    fprintf(fp, "  },\n");
+
+    fprintf(fp, "  \"trace\": {\"fingerprint\": \"%016" PRIx64 "\", \"bytes\": %" PRIu64 ", \"programs\": %u},\n",
+        pReport->fingerprint, pReport->trace_bytes, pStats->program_count);
+
+    fprintf(fp, "  \"summary\": {\n");
+    fprintf(fp, "    \"finished\": %u,\n", pStats->finished_count);
+    fprintf(fp, "    \"turnaround_time\": %u,\n", pStats->turnaround_time);
+    fprintf(fp, "    \"max_overhead\": %.2f,\n", pStats->max_overhead);
+    fprintf(fp, "    \"avg_overhead\": %.2f,\n", pStats->avg_overhead);
+    fprintf(fp, "    \"makespan\": %u,\n", pStats->makespan);
+    fprintf(fp, "    \"cpu_utilisation\": %.4f\n", pStats->cpu_utilisation);
+    fprintf(fp, "  },\n");
+
+    fprintf(fp, "  \"bounds\": {\n");
+    fprintf(fp, "    \"turnaround_time\": %u,\n", pStats->turnaround_bound);
+    fprintf(fp, "    \"makespan\": %u\n", pStats->makespan_bound);
+    fprintf(fp, "  },\n");
+
+    fprintf(fp, "  \"percentiles\": {\n");
+    write_histogram(fp, "turnaround_time", pStats->pTurnaround, 1);
+    fprintf(fp, ",\n");
+    write_histogram(fp, "waiting_time", pStats->pWaiting, 1);
+    fprintf(fp, ",\n");
+    write_histogram(fp, "response_time", pStats->pResponse, 1);
+    fprintf(fp, ",\n");
+    write_histogram(fp, "overhead", pStats->pOverhead, 100);
+    if (pReport->timings) {
+        fprintf(fp, ",\n");
+        write_histogram(fp, "round_trip_us", pStats->pRoundTrip, 1000);
+    }
+    fprintf(fp, "\n  },\n");
+
+    fprintf(fp, "  \"allocator\": {\n");
+    fprintf(fp, "    \"allocations\": %" PRIu64 ",\n", pAllocator->allocations);
+    fprintf(fp, "    \"failed_allocations\": %" PRIu64 ",\n", pAllocator->failed_allocations);
+    fprintf(fp, "    \"frees\": %" PRIu64 ",\n", pAllocator->frees);
+    fprintf(fp, "    \"merges\": %" PRIu64 ",\n", pAllocator->merges);
+    fprintf(fp, "    \"in_use\": %u,\n", pAllocator->in_use);
+    fprintf(fp, "    \"peak_in_use\": %u,\n", pAllocator->peak_in_use);
+    fprintf(fp, "    \"free_blocks\": %u,\n", pAllocator->free_blocks);
+    fprintf(fp, "    \"free_memory\": %u,\n", pAllocator->free_memory);
+    fprintf(fp, "    \"largest_free\": %u,\n", pAllocator->largest_free);
+    fprintf(fp, "    \"fragmentation\": %.4f\n", pAllocator->fragmentation);
+    fprintf(fp, "  },\n");
+
+    child_stats* pChildren = &pStats->children;
+    fprintf(fp, "  \"children\": {\n");
+    fprintf(fp, "    \"service_time\": %" PRIu64, pChildren->service_time);
+    if (!pReport->timings) {
+        fprintf(fp, "\n  }\n");
+        fprintf(fp, "}\n");
+        return;
+    }
+    fprintf(fp, ",\n");
+    fprintf(fp, "    \"user_seconds\": %.6f,\n", pChildren->user_seconds);
+    fprintf(fp, "    \"system_seconds\": %.6f,\n", pChildren->system_seconds);
+    fprintf(fp, "    \"voluntary_switches\": %" PRIu64 ",\n", pChildren->voluntary_switches);
+    fprintf(fp, "    \"involuntary_switches\": %" PRIu64 ",\n", pChildren->involuntary_switches);
+    fprintf(fp, "    \"max_rss_kb\": %" PRIu64 "\n", pChildren->max_rss_kb);
+    fprintf(fp, "  },\n");
+
+    fprintf(fp, "  \"phases\": {\"parse\": %.6f, \"simulate\": %.6f, \"teardown\": %.6f},\n",
+        pReport->parse_seconds, pReport->simulate_seconds, pReport->teardown_seconds);
+
+    struct rusage self_usage;
+    struct rusage children_usage;
+    getrusage(RUSAGE_SELF, &self_usage);
+    getrusage(RUSAGE_CHILDREN, &children_usage);
+    fprintf(fp, "  \"rusage\": {\n");
+    write_rusage(fp, "self", &self_usage);
+    fprintf(fp, ",\n");
+    write_rusage(fp, "children", &children_usage);
+    fprintf(fp, "\n  }\n");
+    fprintf(fp, "}\n");
+}
+
+static void write_histogram(FILE* fp, const char* name, histogram* pHistogram, double scale) {
+    double mean = pHistogram->total > 0 ? pHistogram->sum / (double)pHistogram->total : 0;
+    fprintf(fp, "    \"%s\": {\"count\": %" PRIu64 ", \"mean\": %.2f, \"p50\": %.2f, \"p90\": %.2f, "
+        "\"p99\": %.2f, \"p99.9\": %.2f, \"max\": %.2f}",
+        name,
+        pHistogram->total,
+        mean / scale,
+        histogram_percentile(pHistogram, 50) / scale,
+        histogram_percentile(pHistogram, 90) / scale,
+        histogram_percentile(pHistogram, 99) / scale,
+        histogram_percentile(pHistogram, 99.9) / scale,
+        pHistogram->max / scale);
+}
+
+static void write_string(FILE* fp, const char* string) {
+    fputc('"', fp);
+    for (; *string != '\0'; string++) {
+        if (*string == '"' || *string == '\\') {
+            fprintf(fp, "\\%c", *string);
+        } else if ((uint8_t)*string < 0x20) {
+            fprintf(fp, "\\u%04x", *string);
+        } else {
+            fputc(*string, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+static void write_rusage(FILE* fp, const char* name, struct rusage* pUsage) {
+    fprintf(fp, "    \"%s\": {\"user_seconds\": %.6f, \"system_seconds\": %.6f, "
+        "\"maxrss_kb\": %ld, \"voluntary_switches\": %ld, \"involuntary_switches\": %ld}",
+        name,
+        pUsage->ru_utime.tv_sec + pUsage->ru_utime.tv_usec / 1e6,
+        pUsage->ru_stime.tv_sec + pUsage->ru_stime.tv_usec / 1e6,
+        pUsage->ru_maxrss,
+        pUsage->ru_nvcsw,
+        pUsage->ru_nivcsw);
+}
@@ -0,0 +1,219 @@
+#include "scheduler.h"
+#include "counters.h"
+#include "logger.h"
+#include <dlfcn.h>
+
+// Processes whose service time is within this percentage of the shortest 
+// service time are considered near-equal by memory aware SJF
+#define MEMORY_AWARE_SLACK 10
+
+static THREAD_LOCAL void* pLibrary = NULL; // Handle of a scheduler loaded from a shared object
+
+// Task 1 and 2
+
+static node* shortest_job_first(list* pList);
+static node* round_robin(list* pList);
+static bool round_robin_should_preempt(process* pRunning, list* pReady);
+
+// Task 3
+
+static node* memory_aware_shortest_job_first(list* pList);
+
+// Dependencies
+
+static node* critical_path_first(list* pList);
+
+// Built in schedulers, none of which need to be told about new or ready processes
+
+static const scheduler builtin_schedulers[] = {
+    {
+        .name = "SJF",
+        .pick_next = shortest_job_first,
+    },
+    {
+        .name = "SJF-M",
+        .pick_next = memory_aware_shortest_job_first,
+    },
+    {
+        .name = "RR",
+        .pick_next = round_robin,
+        .should_preempt = round_robin_should_preempt,
+    },
+    {
+        .name = "CP",
+        .pick_next = critical_path_first,
+        .uses_critical_path = TRUE,
+    },
+};
+
+const scheduler* scheduler_find(const char* name) {
+    assert(name != NULL);
+
+    for (uint32_t i=0; i<sizeof(builtin_schedulers)/sizeof(scheduler); i++) {
+        if (strcmp(builtin_schedulers[i].name, name) == 0) 
+            return &builtin_schedulers[i];
+    }
+
+    // Anything that isn't a path can't be a shared object
+    if (strchr(name, '/') == NULL) {
+        errx(EXIT_FAILURE, "unknown scheduler: %s", name);
+    }
+
+    assert(pLibrary == NULL);
+    if ((pLibrary = dlopen(name, RTLD_NOW)) == NULL) {
+        errx(EXIT_FAILURE, "dlopen: %s", dlerror());
+    }
+
+    // Hooks are only looked at once the plugin is known to share our layout
+    // of process, program and scheduler
+    const uint32_t* pAbiVersion = dlsym(pLibrary, SCHEDULER_ABI_SYMBOL);
+    if (pAbiVersion == NULL) {
+        errx(EXIT_FAILURE, "%s does not export %s, rebuild it against scheduler.h", 
+            name, SCHEDULER_ABI_SYMBOL);
+    }
+    if (*pAbiVersion != SCHEDULER_ABI_VERSION) {
+        errx(EXIT_FAILURE, "%s was built against scheduler ABI %u, expected %u", 
+            name, *pAbiVersion, SCHEDULER_ABI_VERSION);
+    }
+
+    const scheduler* pScheduler = dlsym(pLibrary, SCHEDULER_SYMBOL);
+    if (pScheduler == NULL) {
+        errx(EXIT_FAILURE, "dlsym: %s", dlerror());
+    }
+    if (pScheduler->pick_next == NULL) {
+        errx(EXIT_FAILURE, "%s does not implement pick_next", name);
+    }
+
+    LOG(LOG_INFO, "Loaded scheduler %s from %s\n", pScheduler->name, name);
+    return pScheduler;
+}
+
+void scheduler_unload() {
+    if (pLibrary == NULL) return;
+    dlclose(pLibrary);
+    pLibrary = NULL;
+}
+
+static node* shortest_job_first(list* pList) {
+    assert(pList != NULL);
+
+    node* pNode = pList->head;
+    node* pChosen = NULL;
+    uint32_t min_time = 0;
+    
+    // Iterate through list and find process that has
+    // the shortest service time
+    while(pNode != NULL) {
+        COUNTER_ADD(COUNTER_SJF_VISITED, 1);
+        process* pProcess = pNode->data;
+        uint32_t service_time = pProcess->pProgram->service_time;
+
+        // Choose first process that appears
+        if (pChosen == NULL) {
+            min_time = service_time;
+            pChosen = pNode;
+            pNode = pNode->next;
+            continue;
+        }
+
+        process* pChosenProcess = pChosen->data;
+
+        // Otherwise compare and assign accordingly
+        if (min_time == service_time) {
+            if (pChosenProcess->pProgram->time_arrived == pProcess->pProgram->time_arrived) {
+                if(strcmp(pChosenProcess->pProgram->name, pProcess->pProgram->name) > 0) {
+                    pChosen = pNode;
+                    min_time = service_time;
+                }
+            } else if (pChosenProcess->pProgram->time_arrived > pProcess->pProgram->time_arrived) {
+                pChosen = pNode;
+                min_time = service_time;    
+            }
+        }
+        else if (min_time > service_time) {
+            pChosen = pNode;
+            min_time = service_time;
+        }
+
+        pNode = pNode->next;
+    }
+
+    return pChosen;
+}
+
+static node* memory_aware_shortest_job_first(list* pList) {
+    assert(pList != NULL);
+
+    node* pShortest = shortest_job_first(pList);
+    uint32_t min_time = ((process*)pShortest->data)->pProgram->service_time;
+    uint32_t max_time = min_time + min_time*MEMORY_AWARE_SLACK/100;
+
+    // Among processes that are nearly as short as the shortest process, prefer
+    // the one whose completion lets the most waiting memory be admitted
+    node* pChosen = pShortest;
+    uint32_t max_gain = process_unblocked_memory(pShortest->data);
+    for (node* pNode = pList->head; pNode != NULL; pNode = pNode->next) {
+        process* pProcess = pNode->data;
+        if (pNode == pShortest || 
+            pProcess->pProgram->service_time > max_time) 
+            continue;
+
+        uint32_t gain = process_unblocked_memory(pProcess);
+        if (gain > max_gain) {
+            pChosen = pNode;
+            max_gain = gain;
+        }
+    }
+
+    return pChosen;
+}
+
+static node* round_robin(list* pList) {
+    assert(pList != NULL);
+    return pList->head;
+}
+
+static bool round_robin_should_preempt(process* pRunning, list* pReady) {
+    assert(pReady != NULL);
+    return pReady->head != NULL;
+}
+
+static node* critical_path_first(list* pList) {
+    assert(pList != NULL);
+
+    node* pNode = pList->head;
+    node* pChosen = NULL;
+
+    // Iterate through list and find the process that heads the longest
+    // remaining chain of work, breaking ties in the same way as SJF
+    while(pNode != NULL) {
+        program* pProgram = ((process*)pNode->data)->pProgram;
+
+        if (pChosen == NULL) {
+            pChosen = pNode;
+            pNode = pNode->next;
+            continue;
+        }
+
+        program* pChosenProgram = ((process*)pChosen->data)->pProgram;
+        if (pProgram->critical_path != pChosenProgram->critical_path) {
+            if (pProgram->critical_path > pChosenProgram->critical_path) {
+                pChosen = pNode;
+            }
+        } else if (pProgram->service_time != pChosenProgram->service_time) {
+            if (pProgram->service_time < pChosenProgram->service_time) {
+                pChosen = pNode;
+            }
+        } else if (pProgram->time_arrived != pChosenProgram->time_arrived) {
+            if (pProgram->time_arrived < pChosenProgram->time_arrived) {
+                pChosen = pNode;
+            }
+        } else if (strcmp(pChosenProgram->name, pProgram->name) > 0) {
+            pChosen = pNode;
+        }
+
+        pNode = pNode->next;
+    }
+
+    return pChosen;
+}
@@ -0,0 +1,145 @@
+#include "sha256.h"
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+// Fractional parts of the cube roots of the first 64 primes
+static const uint32_t round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * @brief
+ * Processes one full block of input.
+ * @param pContext pointer to context
+ * @param pBlock pointer to SHA256_BLOCK_SIZE bytes of input
+*/
+static void sha256_process_block(sha256_context* pContext, const uint8_t* pBlock);
+
+void sha256_init(sha256_context* pContext) {
+    assert(pContext != NULL);
+
+    // Fractional parts of the square roots of the first 8 primes
+    static const uint32_t initial_state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(pContext->state, initial_state, sizeof(initial_state));
+    pContext->block_length = 0;
+    pContext->length = 0;
+}
+
+void sha256_update(sha256_context* pContext, const void* pBuf, size_t nbytes) {
+    assert(pContext != NULL);
+    assert(pBuf != NULL || nbytes == 0);
+
+    const uint8_t* pBytes = pBuf;
+    pContext->length += nbytes;
+
+    // Top up a partial block first
+    if (pContext->block_length > 0) {
+        size_t copied = SHA256_BLOCK_SIZE - pContext->block_length;
+        if (copied > nbytes) {
+            copied = nbytes;
+        }
+        memcpy(pContext->block + pContext->block_length, pBytes, copied);
+        pContext->block_length += copied;
+        pBytes += copied;
+        nbytes -= copied;
+        if (pContext->block_length < SHA256_BLOCK_SIZE)
+            return;
+        sha256_process_block(pContext, pContext->block);
+        pContext->block_length = 0;
+    }
+
+    // Full blocks are processed straight from the input
+    while (nbytes >= SHA256_BLOCK_SIZE) {
+        sha256_process_block(pContext, pBytes);
+        pBytes += SHA256_BLOCK_SIZE;
+        nbytes -= SHA256_BLOCK_SIZE;
+    }
+
+    memcpy(pContext->block, pBytes, nbytes);
+    pContext->block_length = nbytes;
+}
+
+void sha256_final(sha256_context* pContext, char hex[SHA_HASH_SIZE + 1]) {
+    assert(pContext != NULL);
+    assert(hex != NULL);
+
+    // Append a 1 bit, then zeros until the length fits at the end of a block
+    uint64_t bit_length = pContext->length*8;
+    pContext->block[pContext->block_length++] = 0x80;
+    if (pContext->block_length > SHA256_BLOCK_SIZE - sizeof(uint64_t)) {
+        memset(pContext->block + pContext->block_length, 0, SHA256_BLOCK_SIZE - pContext->block_length);
+        sha256_process_block(pContext, pContext->block);
+        pContext->block_length = 0;
+    }
+    memset(pContext->block + pContext->block_length, 0,
+        SHA256_BLOCK_SIZE - sizeof(uint64_t) - pContext->block_length);
+    for (uint32_t i=0; i<sizeof(uint64_t); i++) {
+        pContext->block[SHA256_BLOCK_SIZE - 1 - i] = bit_length >> (8*i);
+    }
+    sha256_process_block(pContext, pContext->block);
+
+    for (uint32_t i=0; i<8; i++) {
+        sprintf(hex + 8*i, "%08x", pContext->state[i]);
+    }
+    hex[SHA_HASH_SIZE] = '\0';
+}
+
+void sha256_hash(const void* pBuf, size_t nbytes, char hex[SHA_HASH_SIZE + 1]) {
+    sha256_context context;
+    sha256_init(&context);
+    sha256_update(&context, pBuf, nbytes);
+    sha256_final(&context, hex);
+}
+
+static void sha256_process_block(sha256_context* pContext, const uint8_t* pBlock) {
+    uint32_t w[64];
+    for (uint32_t t=0; t<16; t++) {
+        w[t] = (uint32_t)pBlock[4*t] << 24 | (uint32_t)pBlock[4*t + 1] << 16 |
+               (uint32_t)pBlock[4*t + 2] << 8 | (uint32_t)pBlock[4*t + 3];
+    }
+    for (uint32_t t=16; t<64; t++) {
+        uint32_t s0 = ROTR(w[t - 15], 7) ^ ROTR(w[t - 15], 18) ^ (w[t - 15] >> 3);
+        uint32_t s1 = ROTR(w[t - 2], 17) ^ ROTR(w[t - 2], 19) ^ (w[t - 2] >> 10);
+        w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+
+    uint32_t a = pContext->state[0], b = pContext->state[1];
+    uint32_t c = pContext->state[2], d = pContext->state[3];
+    uint32_t e = pContext->state[4], f = pContext->state[5];
+    uint32_t g = pContext->state[6], h = pContext->state[7];
+    for (uint32_t t=0; t<64; t++) {
+        uint32_t s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+        uint32_t choose = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + choose + round_constants[t] + w[t];
+        uint32_t s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+        uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    pContext->state[0] += a;
+    pContext->state[1] += b;
+    pContext->state[2] += c;
+    pContext->state[3] += d;
+    pContext->state[4] += e;
+    pContext->state[5] += f;
+    pContext->state[6] += g;
+    pContext->state[7] += h;
+}
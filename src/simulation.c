@@ -0,0 +1,100 @@
+#include <simulation.h>
+#include <histogram.h>
+
+program* simulation_load(const char* filename, uint32_t* pCount) {
+    assert(filename != NULL);
+    assert(pCount != NULL);
+
+    FILE* fp = fopen(filename, "r");
+    if (fp == NULL) {
+        err(EXIT_FAILURE, "cannot open %s", filename);
+    }
+
+    program* pPrograms = NULL;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+    char* line = NULL;
+    size_t line_size = 0;
+    uint32_t line_number = 0;
+    while (getline(&line, &line_size, fp) != -1) {
+        program new_program = {};
+        if (!program_parse(line, ++line_number, &new_program))
+            continue;
+
+        if (count == capacity) {
+            capacity = capacity == 0 ? 16 : capacity*2;
+            pPrograms = realloc(pPrograms, sizeof(program)*capacity);
+        }
+        pPrograms[count++] = new_program;
+    }
+    FREE(line);
+    fclose(fp);
+
+    *pCount = count;
+    return pPrograms;
+}
+
+void simulation_copy_program(program* pDestination, const program* pSource) {
+    assert(pDestination != NULL);
+    assert(pSource != NULL);
+
+    *pDestination = *pSource;
+    if (pSource->pBursts != NULL) {
+        pDestination->pBursts = malloc(sizeof(uint32_t)*pSource->burst_count);
+        memcpy(pDestination->pBursts, pSource->pBursts, sizeof(uint32_t)*pSource->burst_count);
+    }
+    if (pSource->pDependsOn != NULL) {
+        pDestination->pDependsOn = strdup(pSource->pDependsOn);
+    }
+}
+
+void simulation_free(program** ppPrograms, uint32_t count) {
+    if (*ppPrograms == NULL) return;
+
+    for (uint32_t i=0; i<count; i++) {
+        FREE((*ppPrograms)[i].pBursts);
+        FREE((*ppPrograms)[i].pDependsOn);
+    }
+    FREE(*ppPrograms);
+}
+
+void simulation_run(const program* pPrograms, uint32_t count,
+    const simulation_config* pConfig, simulation_result* pResult) {
+    assert(pPrograms != NULL || count == 0);
+    assert(pConfig != NULL);
+    assert(pConfig->quantum > 0);
+    assert(pResult != NULL);
+
+    process_manager manager = NULL;
+    process_manager_initialise(&manager, pConfig->scheduler_name, pConfig->strategy);
+    cost_model costs = pConfig->costs;
+    set_cost_model(manager, &costs);
+    set_protocol(manager, PROTOCOL_EMULATED);
+    set_output(manager, NULL);
+
+    // The process manager takes ownership of what it is given
+    for (uint32_t i=0; i<count; i++) {
+        program new_program;
+        simulation_copy_program(&new_program, &pPrograms[i]);
+        program_add(manager, &new_program);
+    }
+
+    while (!should_terminate(manager)) {
+        check_pending(manager);
+        if (!keep_process_running(manager)) {
+            switch_process(manager);
+        }
+        update(manager, pConfig->quantum);
+    }
+
+    // Histograms in the stats are only valid until the manager is destroyed
+    run_stats stats;
+    process_manager_get_stats(manager, &stats);
+    uint32_t finished_count = stats.finished_count > 0 ? stats.finished_count : 1;
+    pResult->turnaround_time = stats.pTurnaround->sum / (double)finished_count;
+    pResult->avg_overhead = stats.avg_overhead;
+    pResult->max_overhead = stats.max_overhead;
+    pResult->p99_overhead = histogram_percentile(stats.pOverhead, 99) / 100.0;
+    pResult->makespan = stats.makespan;
+    process_manager_destroy(&manager);
+}
@@ -0,0 +1,79 @@
+#include <spsc_queue.h>
+
+spsc_queue* spsc_queue_create(size_t element_size, size_t capacity) {
+    assert(element_size > 0);
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+    spsc_queue* pQueue = aligned_alloc(SPSC_CACHE_LINE, sizeof(spsc_queue));
+    atomic_init(&pQueue->head, 0);
+    atomic_init(&pQueue->tail, 0);
+    atomic_init(&pQueue->closed, FALSE);
+    pQueue->cached_head = 0;
+    pQueue->cached_tail = 0;
+    pQueue->capacity = capacity;
+    pQueue->element_size = element_size;
+    pQueue->pBuffer = malloc(element_size*capacity);
+    return pQueue;
+}
+
+void spsc_queue_destroy(spsc_queue** ppQueue) {
+    if (*ppQueue == NULL) return;
+
+    FREE((*ppQueue)->pBuffer);
+    FREE((*ppQueue));
+}
+
+bool spsc_queue_try_push(spsc_queue* pQueue, const void* pElement) {
+    assert(pQueue != NULL);
+    assert(pElement != NULL);
+
+    // Only look at the consumer's index when the ring looks full
+    size_t tail = atomic_load_explicit(&pQueue->tail, memory_order_relaxed);
+    if (tail - pQueue->cached_head == pQueue->capacity) {
+        pQueue->cached_head = atomic_load_explicit(&pQueue->head, memory_order_acquire);
+        if (tail - pQueue->cached_head == pQueue->capacity)
+            return FALSE;
+    }
+
+    // The element must be written before the consumer can see the new tail
+    size_t slot = tail & (pQueue->capacity - 1);
+    memcpy(pQueue->pBuffer + slot*pQueue->element_size, pElement, pQueue->element_size);
+    atomic_store_explicit(&pQueue->tail, tail + 1, memory_order_release);
+    return TRUE;
+}
+
+bool spsc_queue_try_pop(spsc_queue* pQueue, void* pElement) {
+    assert(pQueue != NULL);
+    assert(pElement != NULL);
+
+    // Only look at the producer's index when the ring looks empty
+    size_t head = atomic_load_explicit(&pQueue->head, memory_order_relaxed);
+    if (head == pQueue->cached_tail) {
+        pQueue->cached_tail = atomic_load_explicit(&pQueue->tail, memory_order_acquire);
+        if (head == pQueue->cached_tail)
+            return FALSE;
+    }
+
+    // The element must be read before the producer can reuse its slot
+    size_t slot = head & (pQueue->capacity - 1);
+    memcpy(pElement, pQueue->pBuffer + slot*pQueue->element_size, pQueue->element_size);
+    atomic_store_explicit(&pQueue->head, head + 1, memory_order_release);
+    return TRUE;
+}
+
+void spsc_queue_close(spsc_queue* pQueue) {
+    assert(pQueue != NULL);
+
+    atomic_store_explicit(&pQueue->closed, TRUE, memory_order_release);
+}
+
+bool spsc_queue_drained(spsc_queue* pQueue) {
+    assert(pQueue != NULL);
+
+    // Elements pushed before closing are visible once closed is, so the
+    // tail is read again after it
+    if (!atomic_load_explicit(&pQueue->closed, memory_order_acquire))
+        return FALSE;
+    size_t head = atomic_load_explicit(&pQueue->head, memory_order_relaxed);
+    return head == atomic_load_explicit(&pQueue->tail, memory_order_acquire);
+}
@@ -0,0 +1,145 @@
+#include "thread_pool.h"
+#include <pthread.h>
+
+/**
+ * @param lock guards head and tail, which the owner and thieves both move
+ * @param pTasks indices of tasks in the deque
+ * @param head index in pTasks thieves take from
+ * @param tail one past the index in pTasks the owner takes from
+*/
+typedef struct thread_pool_deque {
+    pthread_mutex_t lock;
+    uint32_t* pTasks;
+    uint32_t head;
+    uint32_t tail;
+} thread_pool_deque;
+
+/**
+ * @param pDeques one deque per thread
+ * @param deque_count number of deques
+ * @param run function that runs a task
+ * @param pContext context passed to run
+*/
+typedef struct thread_pool {
+    thread_pool_deque* pDeques;
+    uint32_t deque_count;
+    thread_pool_task run;
+    void* pContext;
+} thread_pool;
+
+/**
+ * @param pPool pool the worker belongs to
+ * @param index index of the worker's deque
+*/
+typedef struct thread_pool_worker {
+    thread_pool* pPool;
+    uint32_t index;
+} thread_pool_worker;
+
+/**
+ * @brief
+ * Takes the next task for a worker, from its own deque if possible and
+ * otherwise from the deque of another worker.
+ * @param pWorker pointer to worker
+ * @param pTask where the index of the task is stored
+ * @return
+ * Whether a task was found. FALSE means every task has been taken.
+*/
+static bool thread_pool_take(thread_pool_worker* pWorker, uint32_t* pTask);
+
+/**
+ * @brief
+ * Runs tasks until none are left.
+ * @param pArg pointer to worker
+*/
+static void* thread_pool_work(void* pArg);
+
+uint32_t thread_pool_run(uint32_t task_count, uint32_t thread_count, thread_pool_task run, void* pContext) {
+    assert(run != NULL);
+
+    if (thread_count == 0) {
+        long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpu_count > 0 ? cpu_count : 1;
+    }
+    if (thread_count > task_count) {
+        thread_count = task_count > 0 ? task_count : 1;
+    }
+
+    // Deal tasks round robin, so neighbouring tasks of similar size spread out
+    thread_pool pool = {
+        .pDeques = calloc(thread_count, sizeof(thread_pool_deque)),
+        .deque_count = thread_count,
+        .run = run,
+        .pContext = pContext,
+    };
+    for (uint32_t i=0; i<thread_count; i++) {
+        pthread_mutex_init(&pool.pDeques[i].lock, NULL);
+        pool.pDeques[i].pTasks = malloc(sizeof(uint32_t)*(task_count/thread_count + 1));
+    }
+    for (uint32_t i=0; i<task_count; i++) {
+        thread_pool_deque* pDeque = &pool.pDeques[i % thread_count];
+        pDeque->pTasks[pDeque->tail++] = i;
+    }
+
+    pthread_t* pThreads = malloc(sizeof(pthread_t)*thread_count);
+    thread_pool_worker* pWorkers = malloc(sizeof(thread_pool_worker)*thread_count);
+    for (uint32_t i=0; i<thread_count; i++) {
+        pWorkers[i].pPool = &pool;
+        pWorkers[i].index = i;
+        if (pthread_create(&pThreads[i], NULL, thread_pool_work, &pWorkers[i]) != 0) {
+            errx(EXIT_FAILURE, "cannot create thread pool worker");
+        }
+    }
+    for (uint32_t i=0; i<thread_count; i++) {
+        pthread_join(pThreads[i], NULL);
+    }
+    FREE(pThreads);
+    FREE(pWorkers);
+
+    for (uint32_t i=0; i<thread_count; i++) {
+        pthread_mutex_destroy(&pool.pDeques[i].lock);
+        FREE(pool.pDeques[i].pTasks);
+    }
+    FREE(pool.pDeques);
+    return thread_count;
+}
+
+static bool thread_pool_take(thread_pool_worker* pWorker, uint32_t* pTask) {
+    assert(pWorker != NULL);
+    assert(pTask != NULL);
+
+    // The owner takes from the tail of its own deque
+    thread_pool* pPool = pWorker->pPool;
+    thread_pool_deque* pOwn = &pPool->pDeques[pWorker->index];
+    pthread_mutex_lock(&pOwn->lock);
+    bool found = pOwn->head < pOwn->tail;
+    if (found) {
+        *pTask = pOwn->pTasks[--pOwn->tail];
+    }
+    pthread_mutex_unlock(&pOwn->lock);
+    if (found)
+        return TRUE;
+
+    // Thieves take from the head of the other deques
+    for (uint32_t i=1; i<pPool->deque_count; i++) {
+        thread_pool_deque* pVictim = &pPool->pDeques[(pWorker->index + i) % pPool->deque_count];
+        pthread_mutex_lock(&pVictim->lock);
+        found = pVictim->head < pVictim->tail;
+        if (found) {
+            *pTask = pVictim->pTasks[pVictim->head++];
+        }
+        pthread_mutex_unlock(&pVictim->lock);
+        if (found)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void* thread_pool_work(void* pArg) {
+    thread_pool_worker* pWorker = pArg;
+    uint32_t task;
+    while (thread_pool_take(pWorker, &task)) {
+        pWorker->pPool->run(task, pWorker->pPool->pContext);
+    }
+    return NULL;
+}
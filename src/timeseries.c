@@ -0,0 +1,166 @@
+#include <timeseries.h>
+#include <inttypes.h>
+
+#define TIMESERIES_FIELD_COUNT 6
+#define TIMESERIES_MAX_ENCODED (TIMESERIES_FIELD_COUNT*10) // 10 bytes per varint
+
+typedef struct timeseries_block {
+    uint8_t bytes[TIMESERIES_BLOCK_SIZE];
+    uint32_t length;
+    uint32_t sample_count;
+} timeseries_block;
+
+static timeseries_block* pBlocks = NULL;
+static uint64_t block_head = 0; // Index of the block being written, never wraps
+static uint64_t dropped_samples = 0;
+static uint32_t sample_interval = 0;
+static uint32_t next_sample_time = 0;
+static bool has_previous = FALSE;
+static int64_t previous[TIMESERIES_FIELD_COUNT] = {};
+
+/**
+ * @brief
+ * Copies the fields of a sample into an array, in CSV column order.
+ * @param pSample sample to copy
+ * @param fields array of TIMESERIES_FIELD_COUNT fields
+*/
+static void sample_fields(run_sample* pSample, int64_t* fields);
+
+/**
+ * @brief
+ * Appends a value to a block as a zigzag encoded varint.
+ * @param pBlock block with at least 10 bytes of space
+ * @param value value to append
+*/
+static void varint_write(timeseries_block* pBlock, int64_t value);
+
+/**
+ * @brief
+ * Reads a zigzag encoded varint.
+ * @param pBlock block to read from
+ * @param pOffset pointer to the offset of the varint, which is advanced past it
+ * @return
+ * Decoded value
+*/
+static int64_t varint_read(timeseries_block* pBlock, uint32_t* pOffset);
+
+void timeseries_enable(uint32_t interval) {
+    assert(pBlocks == NULL);
+
+    pBlocks = calloc(TIMESERIES_BLOCK_COUNT, sizeof(timeseries_block));
+    if (pBlocks == NULL) {
+        err(EXIT_FAILURE, "calloc");
+    }
+    sample_interval = interval;
+}
+
+void timeseries_sample(process_manager manager) {
+    if (pBlocks == NULL) 
+        return;
+
+    run_sample sample;
+    process_manager_get_sample(manager, &sample);
+    if (sample_interval > 0) {
+        if (sample.time < next_sample_time) 
+            return;
+        next_sample_time = sample.time - sample.time % sample_interval + sample_interval;
+    }
+
+    // Skip samples where nothing but time changed
+    int64_t fields[TIMESERIES_FIELD_COUNT];
+    sample_fields(&sample, fields);
+    if (has_previous && 
+        memcmp(fields + 1, previous + 1, sizeof(int64_t)*(TIMESERIES_FIELD_COUNT - 1)) == 0) 
+        return;
+
+    // Start a new block with a keyframe once the current block is full
+    timeseries_block* pBlock = &pBlocks[block_head % TIMESERIES_BLOCK_COUNT];
+    if (pBlock->length + TIMESERIES_MAX_ENCODED > TIMESERIES_BLOCK_SIZE) {
+        block_head++;
+        pBlock = &pBlocks[block_head % TIMESERIES_BLOCK_COUNT];
+        dropped_samples += pBlock->sample_count;
+        pBlock->length = 0;
+        pBlock->sample_count = 0;
+    }
+    if (pBlock->sample_count == 0) {
+        memset(previous, 0, sizeof(previous));
+    }
+
+    for (uint32_t i = 0; i < TIMESERIES_FIELD_COUNT; i++) {
+        varint_write(pBlock, fields[i] - previous[i]);
+        previous[i] = fields[i];
+    }
+    pBlock->sample_count++;
+    has_previous = TRUE;
+}
+
+void timeseries_write(const char* path, process_manager manager) {
+    assert(path != NULL);
+    assert(manager != NULL);
+
+    if (pBlocks == NULL) 
+        return;
+
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL) {
+        err(EXIT_FAILURE, "%s", path);
+    }
+    if (dropped_samples > 0) {
+        fprintf(stderr, "timeseries: dropped %" PRIu64 " oldest samples\n", dropped_samples);
+    }
+    fprintf(fp, "time,input_depth,ready_depth,memory_in_use,largest_free,running\n");
+
+    uint64_t first = block_head >= TIMESERIES_BLOCK_COUNT ? 
+        block_head - TIMESERIES_BLOCK_COUNT + 1 : 0;
+    for (uint64_t index = first; index <= block_head; index++) {
+        timeseries_block* pBlock = &pBlocks[index % TIMESERIES_BLOCK_COUNT];
+        int64_t fields[TIMESERIES_FIELD_COUNT] = {};
+        uint32_t offset = 0;
+
+        for (uint32_t sample = 0; sample < pBlock->sample_count; sample++) {
+            for (uint32_t i = 0; i < TIMESERIES_FIELD_COUNT; i++) {
+                fields[i] += varint_read(pBlock, &offset);
+            }
+            fprintf(fp, "%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",%" PRId64 ",", 
+                fields[0], fields[1], fields[2], fields[3], fields[4]);
+            if (fields[5] >= 0) {
+                fprintf(fp, "%s", program_at(manager, fields[5])->name);
+            }
+            fprintf(fp, "\n");
+        }
+    }
+
+    fclose(fp);
+    FREE(pBlocks);
+}
+
+static void sample_fields(run_sample* pSample, int64_t* fields) {
+    fields[0] = pSample->time;
+    fields[1] = pSample->input_depth;
+    fields[2] = pSample->ready_depth;
+    fields[3] = pSample->memory_in_use;
+    fields[4] = pSample->largest_free;
+    fields[5] = pSample->running;
+}
+
+static void varint_write(timeseries_block* pBlock, int64_t value) {
+    // Zigzag encoding keeps small negative deltas small
+    uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    while (zigzag >= 0x80) {
+        pBlock->bytes[pBlock->length++] = (zigzag & 0x7F) | 0x80;
+        zigzag >>= 7;
+    }
+    pBlock->bytes[pBlock->length++] = zigzag;
+}
+
+static int64_t varint_read(timeseries_block* pBlock, uint32_t* pOffset) {
+    uint64_t zigzag = 0;
+    uint32_t shift = 0;
+    uint8_t byte;
+    do {
+        byte = pBlock->bytes[(*pOffset)++];
+        zigzag |= (uint64_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+}